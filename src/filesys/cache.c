@@ -1,4 +1,6 @@
 #include <debug.h>
+#include <hash.h>
+#include <ohash.h>
 #include <string.h>
 #include "filesys/cache.h"
 #include "filesys/filesys.h"
@@ -15,17 +17,27 @@ struct buffer_cache_entry
 
     bool dirty;  // dirty bit
     bool access; // reference bit, for clock algorithm
+
+    struct ohash_elem hash_elem; // element in cache_index, if used
 };
 
 /* Buffer cache entries. */
 static struct buffer_cache_entry cache[BUFFER_CACHE_SIZE];
 
+/* Entries in use, keyed by disk sector. */
+static struct ohash cache_index;
+
 /* A global lock for synchronizing buffer cache operations. */
 static struct lock buffer_cache_lock;
 
+static unsigned buffer_cache_hash(const struct ohash_elem *e, void *aux);
+static bool buffer_cache_equal(const struct ohash_elem *a,
+                               const struct ohash_elem *b, void *aux);
+
 void buffer_cache_init()
 {
     lock_init(&buffer_cache_lock);
+    ohash_init(&cache_index, buffer_cache_hash, buffer_cache_equal, NULL);
     size_t i;
     for (i = 0; i < BUFFER_CACHE_SIZE; ++i)
     {
@@ -62,17 +74,14 @@ void buffer_cache_close()
 
 static struct buffer_cache_entry *buffer_cache_lookup(block_sector_t sector)
 {
-    size_t i;
-    for (i = 0; i < BUFFER_CACHE_SIZE; ++i)
-    {
-        if (cache[i].used == false)
-            continue;
-        if (cache[i].disk_sector == sector)
-        {
-            return &cache[i];
-        }
-    }
-    return NULL;
+    struct buffer_cache_entry key;
+    struct ohash_elem *e;
+
+    key.disk_sector = sector;
+    e = ohash_find(&cache_index, &key.hash_elem);
+    if (e == NULL)
+        return NULL;
+    return ohash_entry(e, struct buffer_cache_entry, hash_elem);
 }
 
 static struct buffer_cache_entry *buffer_cache_get_slot()
@@ -104,22 +113,41 @@ static struct buffer_cache_entry *buffer_cache_get_slot()
     {
         write_buffer_cache_to_disk(slot);
     }
+    ohash_delete(&cache_index, &slot->hash_elem);
     slot->used = false;
     return slot;
 }
 
+// fills a free slot with sector from disk, evicting if needed.
+// returns NULL if the index could not grow to hold the slot.
+static struct buffer_cache_entry *buffer_cache_fill(block_sector_t sector)
+{
+    struct buffer_cache_entry *sector_block = buffer_cache_get_slot();
+    ASSERT(sector_block != NULL && sector_block->used == false);
+
+    sector_block->disk_sector = sector;
+    if (!ohash_insert(&cache_index, &sector_block->hash_elem))
+        return NULL;
+    sector_block->used = true;
+    sector_block->dirty = false;
+    block_read(fs_device, sector, sector_block->buffer);
+    return sector_block;
+}
+
 void buffer_cache_read(block_sector_t sector, void *target)
 {
     lock_acquire(&buffer_cache_lock);
     struct buffer_cache_entry *sector_block = buffer_cache_lookup(sector);
     if (sector_block == NULL)
     {
-        sector_block = buffer_cache_get_slot();
-        ASSERT(sector_block != NULL && sector_block->used == false);
-        sector_block->used = true;
-        sector_block->disk_sector = sector;
-        sector_block->dirty = false;
-        block_read(fs_device, sector, sector_block->buffer);
+        sector_block = buffer_cache_fill(sector);
+        if (sector_block == NULL)
+        {
+            // out of memory: read around the cache.
+            block_read(fs_device, sector, target);
+            lock_release(&buffer_cache_lock);
+            return;
+        }
     }
 
     sector_block->access = true;
@@ -135,14 +163,14 @@ void buffer_cache_write(block_sector_t sector, const void *source)
     if (sector_block == NULL)
     {
         // cache miss: need eviction.
-        sector_block = buffer_cache_get_slot();
-        ASSERT(sector_block != NULL && sector_block->used == false);
-
-        // fill in the cache entry.
-        sector_block->used = true;
-        sector_block->disk_sector = sector;
-        sector_block->dirty = false;
-        block_read(fs_device, sector, sector_block->buffer);
+        sector_block = buffer_cache_fill(sector);
+        if (sector_block == NULL)
+        {
+            // out of memory: write around the cache.
+            block_write(fs_device, sector, source);
+            lock_release(&buffer_cache_lock);
+            return;
+        }
     }
 
     // copy the data form memory into the buffer cache.
@@ -151,4 +179,18 @@ void buffer_cache_write(block_sector_t sector, const void *source)
     memcpy(sector_block->buffer, source, BLOCK_SECTOR_SIZE);
 
     lock_release(&buffer_cache_lock);
-}
\ No newline at end of file
+}
+
+static unsigned buffer_cache_hash(const struct ohash_elem *e, void *aux UNUSED)
+{
+    const struct buffer_cache_entry *entry =
+        ohash_entry(e, struct buffer_cache_entry, hash_elem);
+    return hash_int(entry->disk_sector);
+}
+
+static bool buffer_cache_equal(const struct ohash_elem *a,
+                               const struct ohash_elem *b, void *aux UNUSED)
+{
+    return ohash_entry(a, struct buffer_cache_entry, hash_elem)->disk_sector
+           == ohash_entry(b, struct buffer_cache_entry, hash_elem)->disk_sector;
+}
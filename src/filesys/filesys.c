@@ -22,14 +22,15 @@ filesys_init (bool format)
   if (fs_device == NULL)
     PANIC ("No file system device found, can't initialize file system.");
 
+  buffer_cache_init ();
   inode_init ();
+  file_init ();
   free_map_init ();
 
   if (format) 
     do_format ();
 
   free_map_open ();
-  buffer_cache_init();
 }
 
 /* Shuts down the file system module, writing any unwritten data
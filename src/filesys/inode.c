@@ -1,12 +1,14 @@
 #include "filesys/inode.h"
 #include "filesys/cache.h"
-#include <list.h>
 #include <debug.h>
+#include <hash.h>
+#include <ohash.h>
 #include <round.h>
 #include <string.h>
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
 #include "threads/malloc.h"
+#include "threads/slab.h"
 
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
@@ -33,7 +35,7 @@ bytes_to_sectors (off_t size)
 /* In-memory inode. */
 struct inode 
   {
-    struct list_elem elem;              /* Element in inode list. */
+    struct ohash_elem hash_elem;        /* Element in open_inodes. */
     block_sector_t sector;              /* Sector number of disk location. */
     int open_cnt;                       /* Number of openers. */
     bool removed;                       /* True if deleted, false otherwise. */
@@ -55,15 +57,22 @@ byte_to_sector (const struct inode *inode, off_t pos)
     return -1;
 }
 
-/* List of open inodes, so that opening a single inode twice
-   returns the same `struct inode'. */
-static struct list open_inodes;
+/* Open inodes, keyed by sector, so that opening a single inode
+   twice returns the same `struct inode'. */
+static struct ohash open_inodes;
+
+static ohash_hash_func inode_hash;
+static ohash_equal_func inode_equal;
+
+/* Cache of in-memory inodes. */
+static struct kmem_cache inode_cache;
 
 /* Initializes the inode module. */
 void
 inode_init (void) 
 {
-  list_init (&open_inodes);
+  ohash_init (&open_inodes, inode_hash, inode_equal, NULL);
+  kmem_cache_init (&inode_cache, "inode", sizeof (struct inode), NULL);
 }
 
 /* Initializes an inode with LENGTH bytes of data and
@@ -113,29 +122,32 @@ inode_create (block_sector_t sector, off_t length)
 struct inode *
 inode_open (block_sector_t sector)
 {
-  struct list_elem *e;
+  struct inode key;
+  struct ohash_elem *e;
   struct inode *inode;
 
   /* Check whether this inode is already open. */
-  for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
-       e = list_next (e)) 
+  key.sector = sector;
+  e = ohash_find (&open_inodes, &key.hash_elem);
+  if (e != NULL)
     {
-      inode = list_entry (e, struct inode, elem);
-      if (inode->sector == sector) 
-        {
-          inode_reopen (inode);
-          return inode; 
-        }
+      inode = ohash_entry (e, struct inode, hash_elem);
+      inode_reopen (inode);
+      return inode; 
     }
 
   /* Allocate memory. */
-  inode = malloc (sizeof *inode);
+  inode = kmem_cache_alloc (&inode_cache);
   if (inode == NULL)
     return NULL;
 
   /* Initialize. */
-  list_push_front (&open_inodes, &inode->elem);
   inode->sector = sector;
+  if (!ohash_insert (&open_inodes, &inode->hash_elem))
+    {
+      kmem_cache_free (&inode_cache, inode);
+      return NULL;
+    }
   inode->open_cnt = 1;
   inode->deny_write_cnt = 0;
   inode->removed = false;
@@ -172,8 +184,8 @@ inode_close (struct inode *inode)
   /* Release resources if this was the last opener. */
   if (--inode->open_cnt == 0)
     {
-      /* Remove from inode list and release lock. */
-      list_remove (&inode->elem);
+      /* Remove from open inodes and release lock. */
+      ohash_delete (&open_inodes, &inode->hash_elem);
  
       /* Deallocate blocks if removed. */
       if (inode->removed) 
@@ -183,7 +195,7 @@ inode_close (struct inode *inode)
                             bytes_to_sectors (inode->data.length)); 
         }
 
-      free (inode); 
+      kmem_cache_free (&inode_cache, inode); 
     }
 }
 
@@ -345,3 +357,21 @@ inode_length (const struct inode *inode)
 {
   return inode->data.length;
 }
+
+/* Returns a hash value for inode I. */
+static unsigned
+inode_hash (const struct ohash_elem *i_, void *aux UNUSED)
+{
+  const struct inode *i = ohash_entry (i_, struct inode, hash_elem);
+  return hash_int (i->sector);
+}
+
+/* Returns true if inodes A and B are for the same sector. */
+static bool
+inode_equal (const struct ohash_elem *a_, const struct ohash_elem *b_,
+             void *aux UNUSED)
+{
+  const struct inode *a = ohash_entry (a_, struct inode, hash_elem);
+  const struct inode *b = ohash_entry (b_, struct inode, hash_elem);
+  return a->sector == b->sector;
+}
@@ -7,7 +7,9 @@
 
 #include "hash.h"
 #include "../debug.h"
+#include "../word.h"
 #include "threads/malloc.h"
+#include "threads/vaddr.h"
 
 #define list_elem_to_hash_elem(LIST_ELEM)                       \
         list_entry(LIST_ELEM, struct hash_elem, list_elem)
@@ -257,25 +259,78 @@ hash_empty (struct hash *h)
   return h->elem_cnt == 0;
 }
 
-/* Fowler-Noll-Vo hash constants, for 32-bit word sizes. */
-#define FNV_32_PRIME 16777619u
-#define FNV_32_BASIS 2166136261u
+/* The hash functions below consume input a 32-bit word at a
+   time, mixing each word in with the MurmurHash3 round function
+   and finishing with its avalanche step, so that every input bit
+   affects the low-order bits that hash tables use to pick a
+   bucket or slot.  Integers and pointers are cheaper to hash:
+   they are multiplied by 2**32 divided by the golden ratio
+   (Fibonacci hashing), which leaves the well-mixed bits at the
+   top, and then the high half is xored into the low half. */
+
+/* Multiplier for Fibonacci hashing. */
+#define GOLDEN_RATIO_32 0x9e3779b9u
+
+/* Returns X rotated left by N bits. */
+static inline uint32_t
+rotl (uint32_t x, int n) 
+{
+  return (x << n) | (x >> (32 - n));
+}
+
+/* Mixes word K into hash value HASH and returns the result. */
+static inline uint32_t
+mix_word (uint32_t hash, uint32_t k) 
+{
+  k *= 0xcc9e2d51u;
+  k = rotl (k, 15);
+  k *= 0x1b873593u;
+  hash ^= k;
+  hash = rotl (hash, 13);
+  return hash * 5 + 0xe6546b64u;
+}
+
+/* Finishes hash value HASH of SIZE bytes of input. */
+static inline unsigned
+finish (uint32_t hash, size_t size) 
+{
+  hash ^= size;
+  hash ^= hash >> 16;
+  hash *= 0x85ebca6bu;
+  hash ^= hash >> 13;
+  hash *= 0xc2b2ae35u;
+  hash ^= hash >> 16;
+  return hash;
+}
+
+/* Returns a word holding the LEFT bytes at BUF, 0 < LEFT < 4, in
+   the same byte positions a whole word would hold them. */
+static inline uint32_t
+tail_word (const unsigned char *buf, size_t left) 
+{
+  uint32_t k = 0;
+
+  while (left-- > 0)
+    k |= (uint32_t) buf[left] << (8 * left);
+  return k;
+}
 
 /* Returns a hash of the SIZE bytes in BUF. */
 unsigned
 hash_bytes (const void *buf_, size_t size)
 {
-  /* Fowler-Noll-Vo 32-bit hash, for bytes. */
   const unsigned char *buf = buf_;
-  unsigned hash;
+  uint32_t hash = 0;
+  size_t left;
 
   ASSERT (buf != NULL);
 
-  hash = FNV_32_BASIS;
-  while (size-- > 0)
-    hash = (hash * FNV_32_PRIME) ^ *buf++;
+  for (left = size; left >= 4; left -= 4, buf += 4)
+    hash = mix_word (hash, *(const word_t *) buf);
+  if (left > 0)
+    hash = mix_word (hash, tail_word (buf, left));
 
-  return hash;
+  return finish (hash, size);
 } 
 
 /* Returns a hash of string S. */
@@ -283,22 +338,72 @@ unsigned
 hash_string (const char *s_) 
 {
   const unsigned char *s = (const unsigned char *) s_;
-  unsigned hash;
+  uint32_t hash = 0;
+  size_t size = 0;
 
   ASSERT (s != NULL);
 
-  hash = FNV_32_BASIS;
-  while (*s != '\0')
-    hash = (hash * FNV_32_PRIME) ^ *s++;
+  /* Take whole words until one contains the null terminator.
+     A word is loaded directly only if it does not cross a page
+     boundary, since the string may end just before one. */
+  for (;;)
+    {
+      uint32_t k;
 
-  return hash;
+      if (pg_ofs (s) <= PGSIZE - sizeof (word_t))
+        {
+          k = *(const word_t *) s;
+          if (word_has_zero (k))
+            break;
+        }
+      else
+        {
+          if (s[0] == '\0' || s[1] == '\0' || s[2] == '\0' || s[3] == '\0')
+            break;
+          k = tail_word (s, 4);
+        }
+      hash = mix_word (hash, k);
+      s += 4;
+      size += 4;
+    }
+
+  /* Take the 0 to 3 bytes before the null terminator. */
+  if (*s != '\0')
+    {
+      size_t left = 1;
+
+      while (s[left] != '\0')
+        left++;
+      hash = mix_word (hash, tail_word (s, left));
+      size += left;
+    }
+
+  return finish (hash, size);
+}
+
+/* Returns a Fibonacci hash of X, folded so that its low-order
+   bits depend on all of X. */
+static inline unsigned
+fib_hash (uint32_t x) 
+{
+  uint32_t hash = x * GOLDEN_RATIO_32;
+  return hash ^ (hash >> 16);
 }
 
 /* Returns a hash of integer I. */
 unsigned
 hash_int (int i) 
 {
-  return hash_bytes (&i, sizeof i);
+  return fib_hash (i);
+}
+
+/* Returns a hash of pointer P.  Pointers to pages and other
+   aligned objects have low-order bits that are always zero;
+   the fold spreads the others into them. */
+unsigned
+hash_ptr (const void *p) 
+{
+  return fib_hash ((uintptr_t) p);
 }
 
 /* Returns the bucket in H that E belongs in. */
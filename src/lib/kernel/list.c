@@ -522,3 +522,150 @@ list_min (struct list *list, list_less_func *less, void *aux)
     }
   return min;
 }
+
+/* Checks that CLIST's count agrees with whether its list is
+   empty.  This costs nothing next to the operation it guards,
+   yet catches most elements that were added or removed without
+   going through the clist_*() functions. */
+static inline void
+clist_check (struct clist *clist)
+{
+  ASSERT (clist != NULL);
+  ASSERT ((clist->size == 0) == list_empty (&clist->list));
+}
+
+/* Initializes CLIST as an empty counted list. */
+void
+clist_init (struct clist *clist)
+{
+  ASSERT (clist != NULL);
+  list_init (&clist->list);
+  clist->size = 0;
+}
+
+/* Inserts ELEM just before BEFORE, which must be an interior
+   element or the tail of CLIST. */
+void
+clist_insert (struct clist *clist, struct list_elem *before,
+              struct list_elem *elem)
+{
+  clist_check (clist);
+  list_insert (before, elem);
+  clist->size++;
+}
+
+/* Removes elements FIRST through LAST (exclusive) from SRC, then
+   inserts them just before BEFORE in DST.  Moving all of SRC
+   takes constant time; moving only part of it takes time
+   proportional to the number of elements moved, which must be
+   counted.  DST and SRC may be the same counted list. */
+void
+clist_splice (struct clist *dst, struct list_elem *before,
+              struct clist *src, struct list_elem *first,
+              struct list_elem *last)
+{
+  size_t cnt;
+
+  clist_check (dst);
+  clist_check (src);
+
+  if (dst == src)
+    {
+      list_splice (before, first, last);
+      return;
+    }
+
+  if (first == list_begin (&src->list) && last == list_end (&src->list))
+    cnt = src->size;
+  else
+    {
+      struct list_elem *e;
+
+      cnt = 0;
+      for (e = first; e != last; e = list_next (e))
+        cnt++;
+      ASSERT (cnt <= src->size);
+    }
+
+  list_splice (before, first, last);
+  src->size -= cnt;
+  dst->size += cnt;
+  clist_check (src);
+}
+
+/* Inserts ELEM at the beginning of CLIST. */
+void
+clist_push_front (struct clist *clist, struct list_elem *elem)
+{
+  clist_insert (clist, list_begin (&clist->list), elem);
+}
+
+/* Inserts ELEM at the end of CLIST. */
+void
+clist_push_back (struct clist *clist, struct list_elem *elem)
+{
+  clist_insert (clist, list_end (&clist->list), elem);
+}
+
+/* Inserts ELEM in the proper position in CLIST, which must be
+   sorted according to LESS given auxiliary data AUX.
+   Runs in O(n) average case in the number of elements in
+   CLIST. */
+void
+clist_insert_ordered (struct clist *clist, struct list_elem *elem,
+                      list_less_func *less, void *aux)
+{
+  clist_check (clist);
+  list_insert_ordered (&clist->list, elem, less, aux);
+  clist->size++;
+}
+
+/* Removes ELEM, which must be in CLIST, and returns the element
+   that followed it. */
+struct list_elem *
+clist_remove (struct clist *clist, struct list_elem *elem)
+{
+  clist_check (clist);
+  ASSERT (clist->size > 0);
+  clist->size--;
+  elem = list_remove (elem);
+  clist_check (clist);
+  return elem;
+}
+
+/* Removes the front element from CLIST and returns it.
+   Undefined behavior if CLIST is empty before removal. */
+struct list_elem *
+clist_pop_front (struct clist *clist)
+{
+  struct list_elem *front = list_front (&clist->list);
+  clist_remove (clist, front);
+  return front;
+}
+
+/* Removes the back element from CLIST and returns it.
+   Undefined behavior if CLIST is empty before removal. */
+struct list_elem *
+clist_pop_back (struct clist *clist)
+{
+  struct list_elem *back = list_back (&clist->list);
+  clist_remove (clist, back);
+  return back;
+}
+
+/* Returns the number of elements in CLIST.
+   Runs in O(1). */
+size_t
+clist_size (struct clist *clist)
+{
+  clist_check (clist);
+  return clist->size;
+}
+
+/* Returns true if CLIST is empty, false otherwise. */
+bool
+clist_empty (struct clist *clist)
+{
+  clist_check (clist);
+  return clist->size == 0;
+}
@@ -178,4 +178,53 @@ void list_unique (struct list *, struct list *duplicates,
 struct list_elem *list_max (struct list *, list_less_func *, void *aux);
 struct list_elem *list_min (struct list *, list_less_func *, void *aux);
 
+/* Counted list.
+
+   A list that also keeps track of how many elements it holds,
+   so that clist_size() runs in O(1) instead of walking the list
+   like list_size().  Elements must be added to and removed from
+   a counted list only through the clist_*() functions below,
+   which keep the count up to date.  Traversal and the other
+   read-only operations work on the embedded `list' member as
+   usual:
+
+      for (e = list_begin (&foo_clist.list);
+           e != list_end (&foo_clist.list); e = list_next (e))
+        ...
+
+   The count is cross-checked against the list with ASSERTs
+   wherever that is cheap, which catches most elements added or
+   removed behind the counted list's back. */
+struct clist
+  {
+    struct list list;           /* Elements. */
+    size_t size;                /* Number of elements in LIST. */
+  };
+
+/* Initializer for a counted list, analogous to
+   LIST_INITIALIZER. */
+#define CLIST_INITIALIZER(NAME) { LIST_INITIALIZER ((NAME).list), 0 }
+
+void clist_init (struct clist *);
+
+/* Counted list insertion. */
+void clist_insert (struct clist *, struct list_elem *before,
+                   struct list_elem *);
+void clist_splice (struct clist *, struct list_elem *before,
+                   struct clist *, struct list_elem *first,
+                   struct list_elem *last);
+void clist_push_front (struct clist *, struct list_elem *);
+void clist_push_back (struct clist *, struct list_elem *);
+void clist_insert_ordered (struct clist *, struct list_elem *,
+                           list_less_func *, void *aux);
+
+/* Counted list removal. */
+struct list_elem *clist_remove (struct clist *, struct list_elem *);
+struct list_elem *clist_pop_front (struct clist *);
+struct list_elem *clist_pop_back (struct clist *);
+
+/* Counted list properties. */
+size_t clist_size (struct clist *);
+bool clist_empty (struct clist *);
+
 #endif /* lib/kernel/list.h */
@@ -0,0 +1,339 @@
+/* Open-addressing hash table.
+
+   See ohash.h for basic information. */
+
+#include "ohash.h"
+#include "../debug.h"
+#include "threads/malloc.h"
+
+/* Table size limits.  The table grows when more than
+   MAX_LOAD_NUM/MAX_LOAD_DEN of its slots are full and shrinks,
+   down to MIN_SLOTS, when fewer than 1/MIN_LOAD_DIV are. */
+#define MIN_SLOTS 8
+#define MAX_LOAD_NUM 3
+#define MAX_LOAD_DEN 4
+#define MIN_LOAD_DIV 8
+
+/* Number of old slots moved to the new array by each insertion
+   or deletion while the table is being resized.  Resizing
+   starts with at most 3/4 of the old slots full and the new
+   array at least twice as big as that, so it finishes well
+   before the new array could fill up. */
+#define MOVE_STEP 4
+
+/* Marks a slot of the old array whose element was moved or
+   deleted. */
+static struct ohash_elem tombstone;
+
+static size_t find_slot (struct ohash *, struct ohash_slot *slots,
+                         size_t slot_cnt, struct ohash_elem *);
+static void insert_slot (struct ohash_slot *slots, size_t slot_cnt,
+                         unsigned hash, struct ohash_elem *);
+static void remove_slot (struct ohash_slot *slots, size_t slot_cnt,
+                         size_t idx);
+static void resize (struct ohash *, size_t slot_cnt);
+static void move_some (struct ohash *);
+static void apply_slots (struct ohash *, struct ohash_slot *slots,
+                         size_t slot_cnt, ohash_action_func *);
+
+/* Initializes hash table H to compute hash values using HASH and
+   compare hash elements using EQUAL, given auxiliary data AUX. */
+bool
+ohash_init (struct ohash *h,
+            ohash_hash_func *hash, ohash_equal_func *equal, void *aux) 
+{
+  h->elem_cnt = 0;
+  h->slot_cnt = MIN_SLOTS;
+  h->slots = calloc (h->slot_cnt, sizeof *h->slots);
+  h->old_cnt = 0;
+  h->old_slots = NULL;
+  h->move_idx = 0;
+  h->hash = hash;
+  h->equal = equal;
+  h->aux = aux;
+  return h->slots != NULL;
+}
+
+/* Destroys hash table H.
+
+   If DESTRUCTOR is non-null, then it is first called for each
+   element in the hash.  DESTRUCTOR may, if appropriate,
+   deallocate the memory used by the hash element. */
+void
+ohash_destroy (struct ohash *h, ohash_action_func *destructor) 
+{
+  if (destructor != NULL)
+    ohash_apply (h, destructor);
+  free (h->slots);
+  free (h->old_slots);
+}
+
+/* Inserts NEW into hash table H and returns true.  Returns false
+   without inserting NEW if an equal element is already in the
+   table, which ohash_find() will return, or if the table is full
+   and memory to grow it could not be allocated.  Growing is
+   attempted well before the table fills up, so the latter only
+   happens after allocations have been failing for a while. */
+bool
+ohash_insert (struct ohash *h, struct ohash_elem *new) 
+{
+  if (ohash_find (h, new) != NULL)
+    return false;
+
+  move_some (h);
+  if (h->old_slots == NULL
+      && (h->elem_cnt + 1) * MAX_LOAD_DEN > h->slot_cnt * MAX_LOAD_NUM)
+    resize (h, h->slot_cnt * 2);
+
+  /* Keep an empty slot, so that searches terminate. */
+  if (h->elem_cnt + 1 >= h->slot_cnt)
+    return false;
+
+  /* ohash_find() left NEW's hash value in NEW. */
+  insert_slot (h->slots, h->slot_cnt, new->hash, new);
+  h->elem_cnt++;
+  return true;
+}
+
+/* Finds and returns an element equal to E in hash table H, or a
+   null pointer if no equal element exists in the table. */
+struct ohash_elem *
+ohash_find (struct ohash *h, struct ohash_elem *e) 
+{
+  size_t idx;
+
+  e->hash = h->hash (e, h->aux);
+  idx = find_slot (h, h->slots, h->slot_cnt, e);
+  if (idx != SIZE_MAX)
+    return h->slots[idx].elem;
+  if (h->old_slots != NULL)
+    {
+      idx = find_slot (h, h->old_slots, h->old_cnt, e);
+      if (idx != SIZE_MAX)
+        return h->old_slots[idx].elem;
+    }
+  return NULL;
+}
+
+/* Finds, removes, and returns an element equal to E in hash
+   table H.  Returns a null pointer if no equal element existed
+   in the table.
+
+   If the elements of the hash table are dynamically allocated,
+   or own resources that are, then it is the caller's
+   responsibility to deallocate them. */
+struct ohash_elem *
+ohash_delete (struct ohash *h, struct ohash_elem *e) 
+{
+  struct ohash_elem *found = NULL;
+  size_t idx;
+
+  e->hash = h->hash (e, h->aux);
+  idx = find_slot (h, h->slots, h->slot_cnt, e);
+  if (idx != SIZE_MAX)
+    {
+      found = h->slots[idx].elem;
+      remove_slot (h->slots, h->slot_cnt, idx);
+    }
+  else if (h->old_slots != NULL)
+    {
+      idx = find_slot (h, h->old_slots, h->old_cnt, e);
+      if (idx != SIZE_MAX)
+        {
+          found = h->old_slots[idx].elem;
+          h->old_slots[idx].elem = &tombstone;
+        }
+    }
+  if (found == NULL)
+    return NULL;
+  h->elem_cnt--;
+
+  move_some (h);
+  if (h->old_slots == NULL && h->slot_cnt > MIN_SLOTS
+      && h->elem_cnt * MIN_LOAD_DIV < h->slot_cnt)
+    resize (h, h->slot_cnt / 2);
+  return found;
+}
+
+/* Calls ACTION for each element in hash table H in arbitrary
+   order.
+   Modifying hash table H while ohash_apply() is running, using
+   any of the functions ohash_destroy(), ohash_insert(), or
+   ohash_delete(), yields undefined behavior, whether done from
+   ACTION or elsewhere. */
+void
+ohash_apply (struct ohash *h, ohash_action_func *action) 
+{
+  ASSERT (action != NULL);
+
+  apply_slots (h, h->slots, h->slot_cnt, action);
+  if (h->old_slots != NULL)
+    apply_slots (h, h->old_slots, h->old_cnt, action);
+}
+
+/* Returns the number of elements in H. */
+size_t
+ohash_size (struct ohash *h) 
+{
+  return h->elem_cnt;
+}
+
+/* Returns true if H contains no elements, false otherwise. */
+bool
+ohash_empty (struct ohash *h) 
+{
+  return h->elem_cnt == 0;
+}
+
+/* Returns the distance of the element with hash value HASH in
+   slot IDX from its home slot in an array of SLOT_CNT slots. */
+static inline size_t
+probe_distance (unsigned hash, size_t idx, size_t slot_cnt) 
+{
+  return (idx - hash) & (slot_cnt - 1);
+}
+
+/* Searches the SLOT_CNT SLOTS of H for an element equal to E,
+   whose hash value must already be in E.  Returns the index of
+   its slot, or SIZE_MAX if there is none.  The search stops at
+   an empty slot or at an element closer to its home slot than
+   E would be at that point, since the Robin Hood rule would have
+   put E there. */
+static size_t
+find_slot (struct ohash *h, struct ohash_slot *slots, size_t slot_cnt,
+           struct ohash_elem *e) 
+{
+  size_t mask = slot_cnt - 1;
+  size_t idx = e->hash & mask;
+  size_t dist;
+
+  for (dist = 0; ; dist++, idx = (idx + 1) & mask)
+    {
+      struct ohash_slot *s = &slots[idx];
+
+      if (s->elem == NULL
+          || probe_distance (s->hash, idx, slot_cnt) < dist)
+        return SIZE_MAX;
+      if (s->hash == e->hash && s->elem != &tombstone
+          && h->equal (s->elem, e, h->aux))
+        return idx;
+    }
+}
+
+/* Inserts element E, with hash value HASH, into the SLOT_CNT
+   SLOTS, which must have an empty slot.  Whenever E, or an
+   element it displaced, is farther from its home slot than the
+   element in the slot it is probing, the two trade places. */
+static void
+insert_slot (struct ohash_slot *slots, size_t slot_cnt,
+             unsigned hash, struct ohash_elem *e) 
+{
+  size_t mask = slot_cnt - 1;
+  size_t idx = hash & mask;
+  struct ohash_slot cur;
+  size_t dist;
+
+  cur.hash = hash;
+  cur.elem = e;
+  for (dist = 0; ; dist++, idx = (idx + 1) & mask)
+    {
+      struct ohash_slot *s = &slots[idx];
+      size_t s_dist;
+
+      if (s->elem == NULL)
+        {
+          *s = cur;
+          return;
+        }
+      s_dist = probe_distance (s->hash, idx, slot_cnt);
+      if (s_dist < dist)
+        {
+          struct ohash_slot tmp = *s;
+          *s = cur;
+          cur = tmp;
+          dist = s_dist;
+        }
+    }
+}
+
+/* Empties slot IDX of the SLOT_CNT SLOTS, shifting each
+   following element that is not in its home slot back by one to
+   close the gap. */
+static void
+remove_slot (struct ohash_slot *slots, size_t slot_cnt, size_t idx) 
+{
+  size_t mask = slot_cnt - 1;
+
+  for (;;)
+    {
+      size_t next = (idx + 1) & mask;
+      struct ohash_slot *s = &slots[next];
+
+      if (s->elem == NULL || probe_distance (s->hash, next, slot_cnt) == 0)
+        break;
+      slots[idx] = *s;
+      idx = next;
+    }
+  slots[idx].elem = NULL;
+}
+
+/* Starts moving the elements of H into a new array of SLOT_CNT
+   slots.  This function can fail because of an out-of-memory
+   condition, but that'll just leave the table too full or too
+   empty; we can still continue. */
+static void
+resize (struct ohash *h, size_t slot_cnt) 
+{
+  struct ohash_slot *slots;
+
+  ASSERT (h->old_slots == NULL);
+
+  slots = calloc (slot_cnt, sizeof *slots);
+  if (slots == NULL)
+    return;
+  h->old_slots = h->slots;
+  h->old_cnt = h->slot_cnt;
+  h->move_idx = 0;
+  h->slots = slots;
+  h->slot_cnt = slot_cnt;
+}
+
+/* If H is being resized, moves up to MOVE_STEP slots' elements
+   from its old array to the new one, and frees the old array
+   once it has all been moved. */
+static void
+move_some (struct ohash *h) 
+{
+  size_t i;
+
+  if (h->old_slots == NULL)
+    return;
+
+  for (i = 0; i < MOVE_STEP && h->move_idx < h->old_cnt; i++)
+    {
+      struct ohash_slot *s = &h->old_slots[h->move_idx++];
+      if (s->elem != NULL && s->elem != &tombstone)
+        {
+          insert_slot (h->slots, h->slot_cnt, s->hash, s->elem);
+          s->elem = &tombstone;
+        }
+    }
+  if (h->move_idx >= h->old_cnt)
+    {
+      free (h->old_slots);
+      h->old_slots = NULL;
+      h->old_cnt = 0;
+    }
+}
+
+/* Calls ACTION for each element in the SLOT_CNT SLOTS of H. */
+static void
+apply_slots (struct ohash *h, struct ohash_slot *slots, size_t slot_cnt,
+             ohash_action_func *action) 
+{
+  size_t i;
+
+  for (i = 0; i < slot_cnt; i++)
+    if (slots[i].elem != NULL && slots[i].elem != &tombstone)
+      action (slots[i].elem, h->aux);
+}
@@ -0,0 +1,106 @@
+#ifndef __LIB_KERNEL_OHASH_H
+#define __LIB_KERNEL_OHASH_H
+
+/* Open-addressing hash table.
+
+   A cache-friendlier alternative to the chained hash table in
+   hash.h, for tables that are searched much more often than
+   they are iterated.  Instead of an array of linked lists, the
+   table is a single array of slots, each holding an element's
+   hash value and a pointer to the element.  Lookups probe
+   consecutive slots, comparing hash values and following an
+   element pointer only when the hash values match, so a typical
+   lookup touches the slot array's cache line and the element's.
+
+   Collisions are resolved by linear probing with the Robin Hood
+   rule: an element being inserted takes the slot of any element
+   that is closer to its home slot than the new one is, which
+   keeps probe sequences short and lets a search stop early.
+   Deletion shifts the following elements back instead of
+   leaving a tombstone behind.
+
+   Growing or shrinking the table is incremental: a new slot
+   array is allocated and every later insertion or deletion
+   moves a few elements from the old array to it, so no single
+   operation pays for moving the whole table.  Searches look in
+   both arrays until the move is complete.  Elements moved or
+   deleted from the old array leave tombstones there, so that
+   its probe sequences stay intact.
+
+   As with hash.h, elements are not allocated by the table.  Each
+   structure that can be in an open-addressing hash table embeds
+   a struct ohash_elem, and ohash_entry() converts back to the
+   containing structure. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Open-addressing hash element. */
+struct ohash_elem 
+  {
+    unsigned hash;              /* Hash value, cached by the table. */
+  };
+
+/* Converts pointer to hash element OHASH_ELEM into a pointer to
+   the structure that OHASH_ELEM is embedded inside.  Supply the
+   name of the outer structure STRUCT and the member name MEMBER
+   of the hash element. */
+#define ohash_entry(OHASH_ELEM, STRUCT, MEMBER)                 \
+        ((STRUCT *) ((uint8_t *) &(OHASH_ELEM)->hash            \
+                     - offsetof (STRUCT, MEMBER.hash)))
+
+/* Computes and returns the hash value for hash element E, given
+   auxiliary data AUX. */
+typedef unsigned ohash_hash_func (const struct ohash_elem *e, void *aux);
+
+/* Returns true if hash elements A and B are equal, given
+   auxiliary data AUX. */
+typedef bool ohash_equal_func (const struct ohash_elem *a,
+                               const struct ohash_elem *b,
+                               void *aux);
+
+/* Performs some operation on hash element E, given auxiliary
+   data AUX. */
+typedef void ohash_action_func (struct ohash_elem *e, void *aux);
+
+/* A slot: an element and its hash value, or a null ELEM if the
+   slot is empty. */
+struct ohash_slot 
+  {
+    unsigned hash;              /* Hash value of ELEM. */
+    struct ohash_elem *elem;    /* Element, or null. */
+  };
+
+/* Open-addressing hash table. */
+struct ohash 
+  {
+    size_t elem_cnt;            /* Number of elements in table. */
+    size_t slot_cnt;            /* Number of slots, a power of 2. */
+    struct ohash_slot *slots;   /* Array of `slot_cnt' slots. */
+    size_t old_cnt;             /* Number of slots in OLD_SLOTS. */
+    struct ohash_slot *old_slots; /* Slots being moved, or null. */
+    size_t move_idx;            /* Next slot of OLD_SLOTS to move. */
+    ohash_hash_func *hash;      /* Hash function. */
+    ohash_equal_func *equal;    /* Comparison function. */
+    void *aux;                  /* Auxiliary data for `hash' and `equal'. */
+  };
+
+/* Basic life cycle. */
+bool ohash_init (struct ohash *, ohash_hash_func *, ohash_equal_func *,
+                 void *aux);
+void ohash_destroy (struct ohash *, ohash_action_func *);
+
+/* Search, insertion, deletion. */
+bool ohash_insert (struct ohash *, struct ohash_elem *);
+struct ohash_elem *ohash_find (struct ohash *, struct ohash_elem *);
+struct ohash_elem *ohash_delete (struct ohash *, struct ohash_elem *);
+
+/* Iteration. */
+void ohash_apply (struct ohash *, ohash_action_func *);
+
+/* Information. */
+size_t ohash_size (struct ohash *);
+bool ohash_empty (struct ohash *);
+
+#endif /* lib/kernel/ohash.h */
@@ -1,5 +1,16 @@
 #include <string.h>
 #include <debug.h>
+#include <stdint.h>
+#include <word.h>
+
+/* The memory functions below work a 32-bit word at a time once
+   the blocks are big enough to make that worthwhile, using the
+   x86 string instructions to move and fill words.  These rely on
+   the direction flag being clear, which the ABI guarantees at
+   function entry. */
+
+/* Blocks shorter than this are handled a byte at a time. */
+#define WORD_THRESHOLD 16
 
 /* Copies SIZE bytes from SRC to DST, which must not overlap.
    Returns DST. */
@@ -12,6 +23,21 @@ memcpy (void *dst_, const void *src_, size_t size)
   ASSERT (dst != NULL || size == 0);
   ASSERT (src != NULL || size == 0);
 
+  if (size >= WORD_THRESHOLD)
+    {
+      /* Copy bytes until DST is word-aligned, then whole words,
+         leaving the last few bytes for the loop below. */
+      size_t head = -(uintptr_t) dst & 3;
+      size_t words;
+
+      size -= head;
+      words = size / 4;
+      size %= 4;
+      asm volatile ("rep movsb"
+                    : "+D" (dst), "+S" (src), "+c" (head) : : "memory");
+      asm volatile ("rep movsl"
+                    : "+D" (dst), "+S" (src), "+c" (words) : : "memory");
+    }
   while (size-- > 0)
     *dst++ = *src++;
 
@@ -58,6 +84,10 @@ memcmp (const void *a_, const void *b_, size_t size)
   ASSERT (a != NULL || size == 0);
   ASSERT (b != NULL || size == 0);
 
+  /* Skip over equal words, then find the differing byte. */
+  for (; size >= 4 && *(const word_t *) a == *(const word_t *) b;
+       a += 4, b += 4)
+    size -= 4;
   for (; size-- > 0; a++, b++)
     if (*a != *b)
       return *a > *b ? +1 : -1;
@@ -98,6 +128,24 @@ memchr (const void *block_, int ch_, size_t size)
 
   ASSERT (block != NULL || size == 0);
 
+  if (size >= WORD_THRESHOLD)
+    {
+      word_t pattern = ch * WORD_ONES;
+
+      /* Scan bytes until BLOCK is word-aligned, then skip whole
+         words that contain no CH.  An aligned word never crosses
+         a page boundary, so this reads no memory that the byte
+         loop would not. */
+      for (; (uintptr_t) block & 3; block++, size--)
+        if (*block == ch)
+          return (void *) block;
+      for (; size >= 4; block += 4, size -= 4)
+        {
+          word_t x = *(const word_t *) block ^ pattern;
+          if (word_has_zero (x))
+            break;
+        }
+    }
   for (; size-- > 0; block++)
     if (*block == ch)
       return (void *) block;
@@ -281,7 +329,23 @@ memset (void *dst_, int value, size_t size)
   unsigned char *dst = dst_;
 
   ASSERT (dst != NULL || size == 0);
-  
+
+  if (size >= WORD_THRESHOLD)
+    {
+      /* Set bytes until DST is word-aligned, then whole words,
+         leaving the last few bytes for the loop below. */
+      size_t head = -(uintptr_t) dst & 3;
+      size_t words;
+      word_t pattern = (unsigned char) value * WORD_ONES;
+
+      size -= head;
+      words = size / 4;
+      size %= 4;
+      asm volatile ("rep stosb"
+                    : "+D" (dst), "+c" (head) : "a" (pattern) : "memory");
+      asm volatile ("rep stosl"
+                    : "+D" (dst), "+c" (words) : "a" (pattern) : "memory");
+    }
   while (size-- > 0)
     *dst++ = value;
 
@@ -22,6 +22,8 @@ enum
     /* Project 3 and optionally project 4. */
     SYS_MMAP,                   /* Map a file into memory. */
     SYS_MUNMAP,                 /* Remove a memory mapping. */
+    SYS_MSYNC,                  /* Write a memory mapping back. */
+    SYS_VMSTAT,                 /* Get virtual memory statistics. */
 
     /* Project 4 only. */
     SYS_CHDIR,                  /* Change the current directory. */
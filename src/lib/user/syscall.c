@@ -153,6 +153,18 @@ munmap (mapid_t mapid)
   syscall1 (SYS_MUNMAP, mapid);
 }
 
+void
+msync (mapid_t mapid)
+{
+  syscall1 (SYS_MSYNC, mapid);
+}
+
+void
+vmstat (struct vmstat *stats, bool system)
+{
+  syscall2 (SYS_VMSTAT, stats, system);
+}
+
 bool
 chdir (const char *dir)
 {
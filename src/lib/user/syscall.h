@@ -3,6 +3,7 @@
 
 #include <stdbool.h>
 #include <debug.h>
+#include <user/vmstat.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -37,6 +38,8 @@ void close (int fd);
 /* Project 3 and optionally project 4. */
 mapid_t mmap (int fd, void *addr);
 void munmap (mapid_t);
+void msync (mapid_t);
+void vmstat (struct vmstat *, bool system);
 
 /* Project 4 only. */
 bool chdir (const char *dir);
@@ -0,0 +1,15 @@
+#ifndef __LIB_USER_VMSTAT_H
+#define __LIB_USER_VMSTAT_H
+
+/* Virtual memory statistics, as reported by vmstat(). */
+struct vmstat
+  {
+    unsigned major_faults;      /* Page faults that read from disk. */
+    unsigned minor_faults;      /* Page faults that did not. */
+    unsigned swap_ins;          /* Pages read back from swap. */
+    unsigned swap_outs;         /* Pages written to swap. */
+    unsigned resident_frames;   /* Frames currently held. */
+    unsigned mmap_writebacks;   /* Mapped pages written to their files. */
+  };
+
+#endif /* lib/user/vmstat.h */
@@ -0,0 +1,29 @@
+#ifndef __LIB_WORD_H
+#define __LIB_WORD_H
+
+/* Helpers for code that works through memory a 32-bit word at a
+   time instead of a byte at a time. */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* A word, for accesses that may alias any other type and need
+   not be aligned. */
+typedef uint32_t word_t __attribute__ ((may_alias, aligned (1)));
+
+/* A word with every byte set to 0x01, and one with the top bit
+   of every byte set. */
+#define WORD_ONES 0x01010101u
+#define WORD_HIGHS 0x80808080u
+
+/* Returns true if some byte of X is zero.  Subtracting 1 from
+   each byte borrows into its top bit only if the byte was zero
+   or already had its top bit set, and masking with ~X rules out
+   the latter. */
+static inline bool
+word_has_zero (uint32_t x) 
+{
+  return ((x - WORD_ONES) & ~x & WORD_HIGHS) != 0;
+}
+
+#endif /* lib/word.h */
@@ -1,7 +1,8 @@
 /* Test program for lib/kernel/list.c.
 
    Attempts to test the list functionality that is not
-   sufficiently tested elsewhere in Pintos.
+   sufficiently tested elsewhere in Pintos, including counted
+   lists.
 
    This is not a test we will run on your submitted projects.
    It is here for completeness.
@@ -30,6 +31,9 @@ static bool value_less (const struct list_elem *, const struct list_elem *,
                         void *);
 static void verify_list_fwd (struct list *, int size);
 static void verify_list_bkwd (struct list *, int size);
+static void test_clist (int size);
+static void verify_clist (struct clist *);
+static struct list_elem *nth_elem (struct list *, int n);
 
 /* Test the linked list implementation. */
 void
@@ -101,6 +105,8 @@ test (void)
           ASSERT ((size_t) ofs < sizeof values / sizeof *values);
           list_unique (&list, NULL, value_less, NULL);
           verify_list_fwd (&list, size);
+
+          test_clist (size);
         }
     }
   
@@ -108,6 +114,115 @@ test (void)
   printf ("list: PASS\n");
 }
 
+/* Tests the counted list functions on a list of SIZE elements,
+   checking the count after every change. */
+static void
+test_clist (int size) 
+{
+  static struct value values[MAX_SIZE];
+  struct clist a, b;
+  struct list_elem *e;
+  int i, cut1, cut2, run;
+
+  /* Assemble a sorted counted list. */
+  for (i = 0; i < size; i++)
+    values[i].value = i;
+  shuffle (values, size);
+  clist_init (&a);
+  clist_init (&b);
+  for (i = 0; i < size; i++) 
+    {
+      clist_insert_ordered (&a, &values[i].elem, value_less, NULL);
+      ASSERT (clist_size (&a) == (size_t) i + 1);
+    }
+  verify_list_fwd (&a.list, size);
+  verify_clist (&a);
+
+  /* Move a random run of elements, possibly empty, to B, then
+     move all of B back where it came from. */
+  cut1 = random_ulong () % (size + 1);
+  cut2 = cut1 + random_ulong () % (size - cut1 + 1);
+  run = cut2 - cut1;
+  clist_splice (&b, list_end (&b.list),
+                &a, nth_elem (&a.list, cut1), nth_elem (&a.list, cut2));
+  ASSERT (clist_size (&a) == (size_t) (size - run));
+  ASSERT (clist_size (&b) == (size_t) run);
+  verify_clist (&a);
+  verify_clist (&b);
+  clist_splice (&a, nth_elem (&a.list, cut1),
+                &b, list_begin (&b.list), list_end (&b.list));
+  ASSERT (clist_empty (&b));
+  verify_list_fwd (&a.list, size);
+  verify_clist (&a);
+
+  /* Move the same run to the front of the same list, which must
+     leave the count alone.  A run that is already at the front
+     cannot be spliced in front of itself. */
+  if (cut1 > 0)
+    clist_splice (&a, list_begin (&a.list),
+                  &a, nth_elem (&a.list, cut1), nth_elem (&a.list, cut2));
+  ASSERT (clist_size (&a) == (size_t) size);
+  verify_clist (&a);
+  for (i = 0, e = list_begin (&a.list); i < size; i++, e = list_next (e)) 
+    {
+      int expected = (i < run ? cut1 + i
+                      : i < cut2 ? i - run
+                      : i);
+      ASSERT (list_entry (e, struct value, elem)->value == expected);
+    }
+
+  /* Take the elements off A in random ways, moving them to the
+     front or back of B. */
+  for (i = size; i > 0; i--) 
+    {
+      switch (random_ulong () % 3) 
+        {
+        case 0:
+          e = clist_pop_front (&a);
+          break;
+        case 1:
+          e = clist_pop_back (&a);
+          break;
+        default:
+          e = nth_elem (&a.list, random_ulong () % i);
+          ASSERT (clist_remove (&a, e) == list_next (e));
+          break;
+        }
+      ASSERT (clist_size (&a) == (size_t) i - 1);
+      verify_clist (&a);
+
+      if (random_ulong () % 2)
+        clist_push_front (&b, e);
+      else
+        clist_push_back (&b, e);
+      ASSERT (clist_size (&b) == (size_t) (size - i + 1));
+      verify_clist (&b);
+    }
+  ASSERT (clist_empty (&a));
+  list_sort (&b.list, value_less, NULL);
+  verify_list_fwd (&b.list, size);
+}
+
+/* Verifies that the count in CLIST matches its list. */
+static void
+verify_clist (struct clist *clist) 
+{
+  ASSERT (clist_size (clist) == list_size (&clist->list));
+  ASSERT (clist_empty (clist) == list_empty (&clist->list));
+}
+
+/* Returns element N of LIST, counting from 0, or the list's tail
+   if N is its size. */
+static struct list_elem *
+nth_elem (struct list *list, int n) 
+{
+  struct list_elem *e = list_begin (list);
+
+  while (n-- > 0)
+    e = list_next (e);
+  return e;
+}
+
 /* Shuffles the CNT elements in ARRAY into random order. */
 static void
 shuffle (struct value *array, size_t cnt) 
@@ -0,0 +1,250 @@
+/* Test program for lib/kernel/ohash.c.
+
+   Inserts and deletes elements in random order, checking after
+   each step that every element that should be in the table can
+   be found and no other can, and, whenever no resize is in
+   progress, that the slot array obeys the Robin Hood invariants
+   that insertion and backward-shift deletion maintain.  One pass
+   uses a hash function with only a few distinct values, so that
+   probe sequences grow long and wrap around the end of the
+   array.
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <hash.h>
+#include <ohash.h>
+#include <random.h>
+#include <stdio.h>
+#include "threads/test.h"
+
+/* Maximum number of elements in a hash table that we will
+   test. */
+#define MAX_SIZE 512
+
+/* A hash table element. */
+struct value
+  {
+    struct ohash_elem elem;     /* Hash table element. */
+    int value;                  /* Item value. */
+    bool present;               /* Should be in the table? */
+  };
+
+static unsigned value_hash (const struct ohash_elem *, void *);
+static unsigned value_hash_bad (const struct ohash_elem *, void *);
+static bool value_equal (const struct ohash_elem *,
+                         const struct ohash_elem *, void *);
+static void count_action (struct ohash_elem *, void *);
+static void shuffle (size_t[], size_t);
+static void test_table (ohash_hash_func *, size_t size);
+static void verify (struct ohash *, struct value[], size_t size);
+static void verify_slots (struct ohash *);
+
+/* Elements visited by count_action(). */
+static size_t apply_cnt;
+
+/* Test the open-addressing hash table implementation. */
+void
+test (void)
+{
+  size_t size;
+
+  printf ("testing various size tables:");
+  for (size = 1; size <= MAX_SIZE; size *= 2)
+    {
+      printf (" %zu", size);
+      test_table (value_hash, size);
+      test_table (value_hash_bad, size);
+    }
+
+  printf (" done\n");
+  printf ("ohash: PASS\n");
+}
+
+/* Fills a table hashed by HASH with SIZE elements in random
+   order, deletes half of them, puts them back, and then deletes
+   them all, verifying the table along the way. */
+static void
+test_table (ohash_hash_func *hash, size_t size)
+{
+  static struct value values[MAX_SIZE];
+  static size_t order[MAX_SIZE];
+  struct ohash h;
+  size_t i;
+
+  ASSERT (ohash_init (&h, hash, value_equal, NULL));
+  for (i = 0; i < size; i++)
+    {
+      values[i].value = i;
+      values[i].present = false;
+      order[i] = i;
+    }
+
+  /* Insert everything, checking that duplicates are refused. */
+  shuffle (order, size);
+  for (i = 0; i < size; i++)
+    {
+      struct value *v = &values[order[i]];
+      struct value dup = *v;
+
+      ASSERT (ohash_insert (&h, &v->elem));
+      v->present = true;
+      ASSERT (!ohash_insert (&h, &dup.elem));
+      ASSERT (ohash_find (&h, &dup.elem) == &v->elem);
+      verify (&h, values, size);
+    }
+
+  /* Delete half, then reinsert them. */
+  shuffle (order, size);
+  for (i = 0; i < size / 2; i++)
+    {
+      struct value *v = &values[order[i]];
+
+      ASSERT (ohash_delete (&h, &v->elem) == &v->elem);
+      v->present = false;
+      ASSERT (ohash_delete (&h, &v->elem) == NULL);
+      verify (&h, values, size);
+    }
+  for (i = 0; i < size / 2; i++)
+    {
+      struct value *v = &values[order[i]];
+
+      ASSERT (ohash_insert (&h, &v->elem));
+      v->present = true;
+      verify (&h, values, size);
+    }
+
+  /* Delete everything, letting the table shrink. */
+  shuffle (order, size);
+  for (i = 0; i < size; i++)
+    {
+      struct value *v = &values[order[i]];
+
+      ASSERT (ohash_delete (&h, &v->elem) == &v->elem);
+      v->present = false;
+      verify (&h, values, size);
+    }
+  ASSERT (ohash_empty (&h));
+
+  ohash_destroy (&h, NULL);
+}
+
+/* Verifies that H contains exactly the SIZE VALUES that are
+   marked present. */
+static void
+verify (struct ohash *h, struct value values[], size_t size)
+{
+  size_t present_cnt = 0;
+  size_t i;
+
+  for (i = 0; i < size; i++)
+    {
+      struct value key;
+      struct ohash_elem *e;
+
+      key.value = values[i].value;
+      e = ohash_find (h, &key.elem);
+      if (values[i].present)
+        {
+          ASSERT (e == &values[i].elem);
+          present_cnt++;
+        }
+      else
+        ASSERT (e == NULL);
+    }
+  ASSERT (ohash_size (h) == present_cnt);
+  ASSERT (ohash_empty (h) == (present_cnt == 0));
+
+  apply_cnt = 0;
+  ohash_apply (h, count_action);
+  ASSERT (apply_cnt == present_cnt);
+
+  if (h->old_slots == NULL)
+    verify_slots (h);
+}
+
+/* Verifies the Robin Hood invariants of H's slot array: every
+   element's cached hash value is right, no empty slot lies
+   between an element and its home slot, and an element is never
+   more than one slot farther from its home than the element
+   before it. */
+static void
+verify_slots (struct ohash *h)
+{
+  size_t mask = h->slot_cnt - 1;
+  size_t elem_cnt = 0;
+  size_t i;
+
+  for (i = 0; i < h->slot_cnt; i++)
+    {
+      struct ohash_slot *s = &h->slots[i];
+      size_t dist, j;
+
+      if (s->elem == NULL)
+        continue;
+      elem_cnt++;
+      ASSERT (s->hash == h->hash (s->elem, h->aux));
+
+      dist = (i - s->hash) & mask;
+      for (j = 1; j <= dist; j++)
+        ASSERT (h->slots[(i - j) & mask].elem != NULL);
+      if (dist > 0)
+        {
+          struct ohash_slot *prev = &h->slots[(i - 1) & mask];
+          ASSERT (dist <= ((i - 1 - prev->hash) & mask) + 1);
+        }
+    }
+  ASSERT (elem_cnt == h->elem_cnt);
+  ASSERT (elem_cnt < h->slot_cnt);
+}
+
+/* Hashes a value. */
+static unsigned
+value_hash (const struct ohash_elem *e, void *aux UNUSED)
+{
+  return hash_int (ohash_entry (e, struct value, elem)->value);
+}
+
+/* Hashes a value to one of only a few hash values, each with its
+   home slot near the end of the slot array. */
+static unsigned
+value_hash_bad (const struct ohash_elem *e, void *aux UNUSED)
+{
+  return -1 - ohash_entry (e, struct value, elem)->value % 4;
+}
+
+/* Returns true if the values of A and B are equal. */
+static bool
+value_equal (const struct ohash_elem *a_, const struct ohash_elem *b_,
+             void *aux UNUSED)
+{
+  const struct value *a = ohash_entry (a_, struct value, elem);
+  const struct value *b = ohash_entry (b_, struct value, elem);
+
+  return a->value == b->value;
+}
+
+/* Counts the elements visited by ohash_apply(). */
+static void
+count_action (struct ohash_elem *e UNUSED, void *aux UNUSED)
+{
+  apply_cnt++;
+}
+
+/* Shuffles the CNT elements in ARRAY into random order. */
+static void
+shuffle (size_t *array, size_t cnt)
+{
+  size_t i;
+
+  for (i = 0; i < cnt; i++)
+    {
+      size_t j = i + random_ulong () % (cnt - i);
+      size_t t = array[j];
+      array[j] = array[i];
+      array[i] = t;
+    }
+}
@@ -0,0 +1,189 @@
+/* Test program for the memory functions in lib/string.c.
+
+   memcpy(), memset(), memcmp() and memchr() work a word at a
+   time on long enough blocks, so this compares them against
+   simple byte-at-a-time versions at every combination of
+   source and destination alignment, over sizes that straddle
+   the word threshold, with bytes above 0x7f in the data.
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <random.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/test.h"
+
+/* Largest block size tested. */
+#define MAX_SIZE 80
+
+/* Size of the test buffers: room for MAX_SIZE bytes at any
+   alignment, with guard bytes on either side. */
+#define BUF_SIZE (MAX_SIZE + 16)
+
+static void randomize (unsigned char *, size_t);
+static void test_memcpy (size_t dst_ofs, size_t src_ofs, size_t size);
+static void test_memset (size_t ofs, size_t size);
+static void test_memcmp (size_t a_ofs, size_t b_ofs, size_t size);
+static void test_memchr (size_t ofs, size_t size);
+
+/* Test the memory functions. */
+void
+test (void)
+{
+  size_t size;
+
+  printf ("testing various sizes:");
+  for (size = 0; size <= MAX_SIZE; size++)
+    {
+      size_t ofs1, ofs2;
+
+      printf (" %zu", size);
+      for (ofs1 = 0; ofs1 < 4; ofs1++)
+        {
+          test_memset (ofs1, size);
+          test_memchr (ofs1, size);
+          for (ofs2 = 0; ofs2 < 4; ofs2++)
+            {
+              test_memcpy (ofs1, ofs2, size);
+              test_memcmp (ofs1, ofs2, size);
+            }
+        }
+    }
+
+  printf (" done\n");
+  printf ("string: PASS\n");
+}
+
+/* Fills the CNT bytes at P with random values, about half of
+   them above 0x7f. */
+static void
+randomize (unsigned char *p, size_t cnt)
+{
+  while (cnt-- > 0)
+    *p++ = random_ulong ();
+}
+
+/* Copies SIZE bytes from offset SRC_OFS to offset DST_OFS and
+   checks that exactly those bytes changed. */
+static void
+test_memcpy (size_t dst_ofs, size_t src_ofs, size_t size)
+{
+  static unsigned char src[BUF_SIZE], dst[BUF_SIZE], orig[BUF_SIZE];
+  size_t i;
+
+  randomize (src, sizeof src);
+  randomize (dst, sizeof dst);
+  for (i = 0; i < sizeof dst; i++)
+    orig[i] = dst[i];
+
+  ASSERT (memcpy (dst + 8 + dst_ofs, src + 8 + src_ofs, size)
+          == dst + 8 + dst_ofs);
+  for (i = 0; i < sizeof dst; i++)
+    {
+      if (i >= 8 + dst_ofs && i < 8 + dst_ofs + size)
+        {
+          ASSERT (dst[i] == src[i - dst_ofs + src_ofs]);
+        }
+      else
+        {
+          ASSERT (dst[i] == orig[i]);
+        }
+    }
+}
+
+/* Sets SIZE bytes at offset OFS to a value above 0x7f and
+   checks that exactly those bytes changed. */
+static void
+test_memset (size_t ofs, size_t size)
+{
+  static unsigned char buf[BUF_SIZE], orig[BUF_SIZE];
+  int value = 0x80 | random_ulong ();
+  size_t i;
+
+  randomize (buf, sizeof buf);
+  for (i = 0; i < sizeof buf; i++)
+    orig[i] = buf[i];
+
+  ASSERT (memset (buf + 8 + ofs, value, size) == buf + 8 + ofs);
+  for (i = 0; i < sizeof buf; i++)
+    {
+      if (i >= 8 + ofs && i < 8 + ofs + size)
+        {
+          ASSERT (buf[i] == (unsigned char) value);
+        }
+      else
+        {
+          ASSERT (buf[i] == orig[i]);
+        }
+    }
+}
+
+/* Compares equal blocks of SIZE bytes at offsets A_OFS and
+   B_OFS, then blocks that differ at each position in turn, in
+   both directions, with one of the differing bytes above
+   0x7f. */
+static void
+test_memcmp (size_t a_ofs, size_t b_ofs, size_t size)
+{
+  static unsigned char a[BUF_SIZE], b[BUF_SIZE];
+  unsigned char *pa = a + 8 + a_ofs;
+  unsigned char *pb = b + 8 + b_ofs;
+  size_t i;
+
+  randomize (a, sizeof a);
+  randomize (b, sizeof b);
+  for (i = 0; i < size; i++)
+    pb[i] = pa[i];
+  ASSERT (memcmp (pa, pb, size) == 0);
+
+  for (i = 0; i < size; i++)
+    {
+      unsigned char save = pa[i];
+
+      pa[i] = 0x80 | random_ulong ();
+      pb[i] = pa[i] & 0x7f;
+      ASSERT (memcmp (pa, pb, size) > 0);
+      ASSERT (memcmp (pb, pa, size) < 0);
+
+      /* A difference past the end must not count. */
+      ASSERT (memcmp (pa, pb, i) == 0);
+      pa[i] = pb[i] = save;
+    }
+}
+
+/* Searches SIZE bytes at offset OFS for a byte at each position
+   in turn, and for one that is not there at all, including
+   0x00 and values above 0x7f. */
+static void
+test_memchr (size_t ofs, size_t size)
+{
+  static unsigned char buf[BUF_SIZE];
+  unsigned char *p = buf + 8 + ofs;
+  unsigned char target = random_ulong () % 2 ? 0x00 : 0x80 | random_ulong ();
+  size_t i, j;
+
+  /* Fill the buffer, guard bytes included, with bytes other than
+     TARGET. */
+  randomize (buf, sizeof buf);
+  for (j = 0; j < sizeof buf; j++)
+    if (buf[j] == target)
+      buf[j] ^= 1;
+
+  for (i = 0; i < size; i++)
+    {
+      p[i] = target;
+      ASSERT (memchr (p, target, size) == p + i);
+      ASSERT (memchr (p, target, i) == NULL);
+      p[i] ^= 1;
+    }
+
+  /* TARGET just past the end must not be found. */
+  p[size] = target;
+  ASSERT (memchr (p, target, size) == NULL);
+  p[size] ^= 1;
+}
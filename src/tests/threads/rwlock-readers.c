@@ -0,0 +1,77 @@
+/* Checks that several readers can hold a reader-writer lock at
+   once, and that a writer waits until the last of them has
+   left. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define READER_CNT 3
+
+static thread_func reader_thread, writer_thread;
+static struct rwlock rwlock;
+static struct semaphore entered, leave, left, done;
+static bool writer_in;
+
+void
+test_rwlock_readers (void) 
+{
+  int i;
+
+  rwlock_init (&rwlock);
+  sema_init (&entered, 0);
+  sema_init (&leave, 0);
+  sema_init (&left, 0);
+  sema_init (&done, 0);
+
+  /* Each reader signals ENTERED only once it holds the lock, so
+     this would hang if readers excluded each other. */
+  for (i = 0; i < READER_CNT; i++) 
+    {
+      char name[16];
+      snprintf (name, sizeof name, "reader %d", i);
+      thread_create (name, PRI_DEFAULT, reader_thread, NULL);
+    }
+  for (i = 0; i < READER_CNT; i++)
+    sema_down (&entered);
+  msg ("%d readers hold the lock.", READER_CNT);
+
+  /* Let the readers go one at a time, checking that the writer
+     stays out until none are left. */
+  thread_create ("writer", PRI_DEFAULT, writer_thread, NULL);
+  for (i = 0; i < READER_CNT; i++) 
+    {
+      timer_sleep (10);
+      if (writer_in)
+        fail ("Writer got in with %d readers holding the lock.",
+              READER_CNT - i);
+      sema_up (&leave);
+      sema_down (&left);
+    }
+  msg ("Writer waited for every reader to leave.");
+
+  sema_down (&done);
+  msg ("Writer got the lock.");
+}
+
+static void
+reader_thread (void *aux UNUSED) 
+{
+  rwlock_read_acquire (&rwlock);
+  sema_up (&entered);
+  sema_down (&leave);
+  rwlock_read_release (&rwlock);
+  sema_up (&left);
+}
+
+static void
+writer_thread (void *aux UNUSED) 
+{
+  rwlock_write_acquire (&rwlock);
+  writer_in = true;
+  rwlock_write_release (&rwlock);
+  sema_up (&done);
+}
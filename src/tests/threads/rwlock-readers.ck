@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rwlock-readers) begin
+(rwlock-readers) 3 readers hold the lock.
+(rwlock-readers) Writer waited for every reader to leave.
+(rwlock-readers) Writer got the lock.
+(rwlock-readers) end
+EOF
+pass;
@@ -0,0 +1,124 @@
+/* Checks rwlock_upgrade() and rwlock_downgrade().
+
+   First, the main thread upgrades while another reader holds
+   the lock and a writer waits for it.  The upgrade must wait for
+   the reader to leave but go ahead of the writer, and the
+   following downgrade must not let the writer in.
+
+   Second, two readers upgrade at once.  The first must succeed
+   atomically; the second must drop its read hold, let the first
+   through, and report that it was not atomic. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+static void upgrade_past_writer (void);
+static void upgrade_twice (void);
+static thread_func reader_thread, writer_thread, upgrader_thread;
+static struct rwlock rwlock;
+static struct semaphore entered, done;
+static bool reader_left, writer_in, upgraded, upgrader_done;
+
+void
+test_rwlock_upgrade (void) 
+{
+  upgrade_past_writer ();
+  upgrade_twice ();
+}
+
+static void
+upgrade_past_writer (void) 
+{
+  rwlock_init (&rwlock);
+  sema_init (&entered, 0);
+  sema_init (&done, 0);
+
+  rwlock_read_acquire (&rwlock);
+  thread_create ("reader", PRI_DEFAULT, reader_thread, NULL);
+  sema_down (&entered);
+  thread_create ("writer", PRI_DEFAULT, writer_thread, NULL);
+  timer_sleep (10);
+
+  if (!rwlock_upgrade (&rwlock))
+    fail ("Upgrade without a competing upgrader was not atomic.");
+  if (!reader_left)
+    fail ("Upgraded while another reader held the lock.");
+  if (writer_in)
+    fail ("Waiting writer got in ahead of the upgrade.");
+  if (!rwlock_held_for_write (&rwlock))
+    fail ("Not holding the lock for writing after upgrade.");
+  msg ("Upgraded after the other reader left, ahead of the writer.");
+
+  rwlock_downgrade (&rwlock);
+  timer_sleep (10);
+  if (writer_in)
+    fail ("Writer got in after the downgrade.");
+  msg ("Downgraded without letting the writer in.");
+
+  rwlock_read_release (&rwlock);
+  sema_down (&done);
+  sema_down (&done);
+  if (!writer_in)
+    fail ("Writer never got the lock.");
+  msg ("Writer got the lock once the last reader left.");
+}
+
+static void
+upgrade_twice (void) 
+{
+  rwlock_init (&rwlock);
+  sema_init (&entered, 0);
+  sema_init (&done, 0);
+
+  rwlock_read_acquire (&rwlock);
+  thread_create ("upgrader", PRI_DEFAULT, upgrader_thread, NULL);
+  sema_down (&entered);
+  timer_sleep (10);
+
+  if (rwlock_upgrade (&rwlock))
+    fail ("Second upgrade claimed to be atomic.");
+  if (!upgrader_done)
+    fail ("Second upgrader got the lock before the first.");
+  msg ("Second upgrader let the first one through.");
+
+  rwlock_write_release (&rwlock);
+  sema_down (&done);
+  if (!upgraded)
+    fail ("First upgrade was not atomic.");
+  msg ("First upgrader was atomic.");
+}
+
+static void
+reader_thread (void *aux UNUSED) 
+{
+  rwlock_read_acquire (&rwlock);
+  sema_up (&entered);
+  timer_sleep (50);
+  reader_left = true;
+  rwlock_read_release (&rwlock);
+  sema_up (&done);
+}
+
+static void
+writer_thread (void *aux UNUSED) 
+{
+  rwlock_write_acquire (&rwlock);
+  writer_in = true;
+  rwlock_write_release (&rwlock);
+  sema_up (&done);
+}
+
+static void
+upgrader_thread (void *aux UNUSED) 
+{
+  rwlock_read_acquire (&rwlock);
+  sema_up (&entered);
+  upgraded = rwlock_upgrade (&rwlock);
+  upgrader_done = true;
+  rwlock_write_release (&rwlock);
+  sema_up (&done);
+}
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rwlock-upgrade) begin
+(rwlock-upgrade) Upgraded after the other reader left, ahead of the writer.
+(rwlock-upgrade) Downgraded without letting the writer in.
+(rwlock-upgrade) Writer got the lock once the last reader left.
+(rwlock-upgrade) Second upgrader let the first one through.
+(rwlock-upgrade) First upgrader was atomic.
+(rwlock-upgrade) end
+EOF
+pass;
@@ -0,0 +1,64 @@
+/* Checks that once a writer is waiting for a reader-writer lock,
+   a reader that arrives later waits behind it, even though the
+   lock is only held for reading. */
+
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+static thread_func writer_thread, reader_thread;
+static struct rwlock rwlock;
+static struct semaphore done;
+
+/* Record of events, in order.  Only threads holding RWLOCK
+   append to it, so the appends cannot race. */
+static char events[8];
+static size_t event_cnt;
+
+void
+test_rwlock_writer_pref (void) 
+{
+  rwlock_init (&rwlock);
+  sema_init (&done, 0);
+
+  rwlock_read_acquire (&rwlock);
+  thread_create ("writer", PRI_DEFAULT, writer_thread, NULL);
+  timer_sleep (10);
+  thread_create ("reader", PRI_DEFAULT, reader_thread, NULL);
+  timer_sleep (10);
+  if (event_cnt != 0)
+    fail ("\"%s\" got in while the lock was held for reading.",
+          events[0] == 'W' ? "writer" : "reader");
+  msg ("Writer and late reader both wait.");
+
+  rwlock_read_release (&rwlock);
+  sema_down (&done);
+  sema_down (&done);
+  if (strcmp (events, "WwR"))
+    fail ("Events happened in order \"%s\" instead of \"WwR\".", events);
+  msg ("Writer went ahead of the late reader.");
+}
+
+static void
+writer_thread (void *aux UNUSED) 
+{
+  rwlock_write_acquire (&rwlock);
+  events[event_cnt++] = 'W';
+  timer_sleep (10);
+  events[event_cnt++] = 'w';
+  rwlock_write_release (&rwlock);
+  sema_up (&done);
+}
+
+static void
+reader_thread (void *aux UNUSED) 
+{
+  rwlock_read_acquire (&rwlock);
+  events[event_cnt++] = 'R';
+  rwlock_read_release (&rwlock);
+  sema_up (&done);
+}
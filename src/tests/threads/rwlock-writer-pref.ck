@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rwlock-writer-pref) begin
+(rwlock-writer-pref) Writer and late reader both wait.
+(rwlock-writer-pref) Writer went ahead of the late reader.
+(rwlock-writer-pref) end
+EOF
+pass;
@@ -0,0 +1,57 @@
+/* Writes to a file through a mapping and calls msync, then
+   verifies with the read system call that the data reached the
+   file while it was still mapped.  Also verifies that msync on
+   a mapping identifier that was never returned by mmap does
+   nothing. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  static const char overwrite[] = "Now is the time for all good...";
+  static char buffer[sizeof sample - 1];
+  char *actual = (char *) 0x54321000;
+  int handle;
+  mapid_t map;
+
+  /* Open file, map, modify through the mapping. */
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK ((map = mmap (handle, actual)) != MAP_FAILED, "mmap \"sample.txt\"");
+  memcpy (actual, overwrite, strlen (overwrite));
+
+  /* Write back without unmapping. */
+  msg ("msync \"sample.txt\"");
+  msync (map);
+
+  /* Read file back while still mapped. */
+  CHECK (read (handle, buffer, sizeof buffer) == sizeof buffer,
+         "read \"sample.txt\"");
+  if (memcmp (buffer, overwrite, strlen (overwrite))
+      || memcmp (buffer + strlen (overwrite), sample + strlen (overwrite),
+                 strlen (sample) - strlen (overwrite)))
+    {
+      if (!memcmp (buffer, sample, strlen (sample)))
+        fail ("msync did not write back dirty page");
+      else
+        fail ("read surprising data from file");
+    }
+  else
+    msg ("file change was written by msync");
+
+  /* Mapping identifiers are not guessable, so an unknown one
+     must be ignored rather than killing the process. */
+  msg ("msync bad mapid");
+  msync (map + 1234);
+
+  /* The mapping must be intact. */
+  if (memcmp (actual, overwrite, strlen (overwrite)))
+    fail ("mapping changed after msync");
+  msg ("munmap \"sample.txt\"");
+  munmap (map);
+  close (handle);
+}
@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(mmap-msync) begin
+(mmap-msync) open "sample.txt"
+(mmap-msync) mmap "sample.txt"
+(mmap-msync) msync "sample.txt"
+(mmap-msync) read "sample.txt"
+(mmap-msync) file change was written by msync
+(mmap-msync) msync bad mapid
+(mmap-msync) munmap "sample.txt"
+(mmap-msync) end
+EOF
+pass;
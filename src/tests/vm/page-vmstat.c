@@ -0,0 +1,90 @@
+/* Checks that the vmstat system call reports counters that move
+   the way they should: touching new pages adds faults and
+   resident frames, cycling through more memory than fits in RAM
+   adds swap-outs and swap-ins, and the process's counters never
+   exceed the whole system's. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/arc4.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (3 * 1024 * 1024)
+
+static char buf[SIZE];
+
+/* Fails unless each of PROC's counters is at most the
+   corresponding counter in SYS. */
+static void
+check_within (const struct vmstat *proc, const struct vmstat *sys)
+{
+  if (proc->major_faults > sys->major_faults
+      || proc->minor_faults > sys->minor_faults
+      || proc->swap_ins > sys->swap_ins
+      || proc->swap_outs > sys->swap_outs
+      || proc->resident_frames > sys->resident_frames
+      || proc->mmap_writebacks > sys->mmap_writebacks)
+    fail ("process counters exceed system counters");
+}
+
+/* Fails if any counter other than resident_frames went down
+   from OLD to NEW. */
+static void
+check_monotonic (const struct vmstat *old, const struct vmstat *new)
+{
+  if (new->major_faults < old->major_faults
+      || new->minor_faults < old->minor_faults
+      || new->swap_ins < old->swap_ins
+      || new->swap_outs < old->swap_outs
+      || new->mmap_writebacks < old->mmap_writebacks)
+    fail ("counters went backward");
+}
+
+void
+test_main (void)
+{
+  struct vmstat proc0, sys0, proc1, sys1, proc2, sys2;
+  struct arc4 arc4;
+  size_t i;
+
+  vmstat (&proc0, false);
+  vmstat (&sys0, true);
+  check_within (&proc0, &sys0);
+  msg ("initial counters consistent");
+
+  /* Touching a page for the first time faults it in. */
+  buf[0] = 1;
+  vmstat (&proc1, false);
+  vmstat (&sys1, true);
+  check_within (&proc1, &sys1);
+  check_monotonic (&proc0, &proc1);
+  check_monotonic (&sys0, &sys1);
+  if (proc1.major_faults + proc1.minor_faults
+      <= proc0.major_faults + proc0.minor_faults)
+    fail ("touching a new page did not count a fault");
+  if (proc1.resident_frames <= proc0.resident_frames)
+    fail ("touching a new page did not add a resident frame");
+  msg ("touching a page counts a fault and a frame");
+
+  /* Fill more memory than fits with data that does not compress,
+     then read it all back, so that pages go out to swap and come
+     back in. */
+  arc4_init (&arc4, "vmstat", 6);
+  arc4_crypt (&arc4, buf, SIZE);
+  arc4_init (&arc4, "vmstat", 6);
+  arc4_crypt (&arc4, buf, SIZE);
+  for (i = 0; i < SIZE; i++)
+    if (buf[i] != (i == 0))
+      fail ("byte %zu != %d", i, i == 0);
+  vmstat (&proc2, false);
+  vmstat (&sys2, true);
+  check_within (&proc2, &sys2);
+  check_monotonic (&proc1, &proc2);
+  check_monotonic (&sys1, &sys2);
+  if (proc2.swap_outs <= proc1.swap_outs)
+    fail ("paging through %d bytes did not count swap-outs", SIZE);
+  if (proc2.swap_ins <= proc1.swap_ins)
+    fail ("paging through %d bytes did not count swap-ins", SIZE);
+  msg ("paging counts swap-outs and swap-ins");
+}
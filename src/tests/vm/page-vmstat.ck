@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(page-vmstat) begin
+(page-vmstat) initial counters consistent
+(page-vmstat) touching a page counts a fault and a frame
+(page-vmstat) paging counts swap-outs and swap-ins
+(page-vmstat) end
+EOF
+pass;
@@ -37,10 +37,20 @@
 #include "filesys/filesys.h"
 #include "filesys/fsutil.h"
 #endif
+#ifdef VM
+#include "vm/frame.h"
+#include "vm/mmap.h"
+#include "vm/page.h"
+#include "vm/swap.h"
+#endif
 
 /* Page directory with kernel mappings only. */
 uint32_t *init_page_dir;
 
+/* Page size extension: support for 4 MB pages. */
+#define CPUID_PSE 0x00000008    /* CPUID.1:EDX bit: PSE supported. */
+#define CR4_PSE 0x00000010      /* CR4 bit: PSE enabled. */
+
 #ifdef FILESYS
 /* -f: Format the file system? */
 static bool format_filesys;
@@ -59,6 +69,7 @@ static size_t user_page_limit = SIZE_MAX;
 
 static void bss_init (void);
 static void paging_init (void);
+static bool cpu_has_pse (void);
 
 static char **read_command_line (void);
 static char **parse_options (char **argv);
@@ -127,6 +138,14 @@ main (void)
   filesys_init (format_filesys);
 #endif
 
+#ifdef VM
+  /* Initialize virtual memory. */
+  vm_frame_init ();
+  vm_mmap_init ();
+  swap_init ();
+  vm_page_start ();
+#endif
+
   printf ("Boot complete.\n");
   
   /* Run actions specified on kernel command line. */
@@ -153,14 +172,30 @@ bss_init (void)
 /* Populates the base page directory and page table with the
    kernel virtual mapping, and then sets up the CPU to use the
    new page directory.  Points init_page_dir to the page
-   directory it creates. */
+   directory it creates.
+
+   If the CPU supports them, each 4 MB of RAM is mapped with a
+   single 4 MB page, which takes one TLB entry instead of 1024
+   and needs no page table.  The 4 MB that hold the kernel text,
+   which must be read-only at page granularity, and any last 4 MB
+   that is only partly RAM still use 4 kB pages. */
 static void
 paging_init (void)
 {
   uint32_t *pd, *pt;
   size_t page;
+  bool pse = cpu_has_pse ();
   extern char _start, _end_kernel_text;
 
+  if (pse)
+    {
+      /* Enable 4 MB pages.  See [IA32-v3a] 3.6.1 "Paging
+         Options". */
+      uint32_t cr4;
+      asm volatile ("movl %%cr4, %0" : "=r" (cr4));
+      asm volatile ("movl %0, %%cr4" : : "r" (cr4 | CR4_PSE));
+    }
+
   pd = init_page_dir = palloc_get_page (PAL_ASSERT | PAL_ZERO);
   pt = NULL;
   for (page = 0; page < init_ram_pages; page++)
@@ -173,6 +208,14 @@ paging_init (void)
 
       if (pd[pde_idx] == 0)
         {
+          if (pse && pte_idx == 0
+              && page + PTSPAN / PGSIZE <= init_ram_pages
+              && (vaddr + PTSPAN <= &_start || vaddr >= &_end_kernel_text))
+            {
+              pd[pde_idx] = pde_create_large (vaddr, true);
+              page += PTSPAN / PGSIZE - 1;
+              continue;
+            }
           pt = palloc_get_page (PAL_ASSERT | PAL_ZERO);
           pd[pde_idx] = pde_create (pt);
         }
@@ -188,6 +231,17 @@ paging_init (void)
   asm volatile ("movl %0, %%cr3" : : "r" (vtop (init_page_dir)));
 }
 
+/* Returns true if the CPU supports 4 MB pages.  See [IA32-v2a]
+   "CPUID--CPU Identification". */
+static bool
+cpu_has_pse (void)
+{
+  uint32_t eax = 1, ebx, ecx = 0, edx;
+
+  asm ("cpuid" : "+a" (eax), "=b" (ebx), "+c" (ecx), "=d" (edx));
+  return (edx & CPUID_PSE) != 0;
+}
+
 /* Breaks the kernel command line into words and returns them as
    an argv-like array. */
 static char **
@@ -259,6 +313,14 @@ parse_options (char **argv)
 #ifdef USERPROG
       else if (!strcmp (name, "-ul"))
         user_page_limit = atoi (value);
+#endif
+#ifdef VM
+      else if (!strcmp (name, "-fa"))
+        vm_page_fault_around = atoi (value);
+      else if (!strcmp (name, "-sl"))
+        vm_page_stack_max = atoi (value);
+      else if (!strcmp (name, "-vs"))
+        vm_frame_stats_at_exit = true;
 #endif
       else
         PANIC ("unknown option `%s' (use -h for help)", name);
@@ -381,6 +443,11 @@ usage (void)
           "  -mlfqs             Use multi-level feedback queue scheduler.\n"
 #ifdef USERPROG
           "  -ul=COUNT          Limit user memory to COUNT pages.\n"
+#endif
+#ifdef VM
+          "  -fa=COUNT          Map up to COUNT file pages per page fault.\n"
+          "  -sl=COUNT          Limit user stacks to COUNT pages.\n"
+          "  -vs                Print VM statistics as each process exits.\n"
 #endif
           );
   shutdown_power_off ();
@@ -5,6 +5,7 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/loader.h"
 #include "threads/palloc.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
@@ -28,16 +29,29 @@
    blocks, we remove all of the arena's blocks from the free list
    and give the arena back to the page allocator.
 
-   We can't handle blocks bigger than 2 kB using this scheme,
-   because they're too big to fit in a single page with a
-   descriptor.  We handle those by allocating contiguous pages
-   with the page allocator and sticking the allocation size at
-   the beginning of the allocated block's arena header. */
+   Blocks of more than half a page would waste much of a
+   single-page arena, so descriptors for bigger blocks, in
+   intermediate sizes (1.5 kB, 2 kB, 3 kB, 4 kB, 6 kB, ...)
+   rather than powers of 2, use arenas of several contiguous
+   pages, as many as it takes to waste no more than an eighth of
+   the arena.  A block in such an arena may not share a page with
+   the arena header, so each page of the arena is recorded in
+   ARENA_MAP, a table indexed by physical page number.
+
+   We can't handle blocks bigger than the largest descriptor
+   using this scheme.  We handle those by allocating contiguous
+   pages with the page allocator and sticking the allocation size
+   at the beginning of the allocated block's arena header.
+   realloc() resizes such a block in place, by freeing pages at
+   its end or allocating the pages that follow it if they are
+   free, and returns a block whose new size falls in the same
+   descriptor unchanged. */
 
 /* Descriptor. */
 struct desc
   {
     size_t block_size;          /* Size of each element in bytes. */
+    size_t arena_pages;         /* Number of pages in an arena. */
     size_t blocks_per_arena;    /* Number of blocks in an arena. */
     struct list free_list;      /* List of free blocks. */
     struct lock lock;           /* Lock. */
@@ -60,10 +74,21 @@ struct block
     struct list_elem free_elem; /* Free list element. */
   };
 
+/* Maximum number of pages in an arena. */
+#define ARENA_MAX_PAGES 8
+
 /* Our set of descriptors. */
-static struct desc descs[10];   /* Descriptors. */
+static struct desc descs[16];   /* Descriptors. */
 static size_t desc_cnt;         /* Number of descriptors. */
 
+/* Arena of each physical page in a multi-page arena, or null. */
+static struct arena **arena_map;
+
+static void desc_init (size_t block_size);
+static struct desc *size_to_desc (size_t size);
+static bool resize_in_place (void *block, size_t new_size);
+static void arena_map_set (struct arena *, size_t page_cnt,
+                           struct arena *value);
 static struct arena *block_to_arena (struct block *);
 static struct block *arena_to_block (struct arena *, size_t idx);
 
@@ -71,17 +96,62 @@ static struct block *arena_to_block (struct arena *, size_t idx);
 void
 malloc_init (void) 
 {
+  size_t map_pages = DIV_ROUND_UP (init_ram_pages * sizeof *arena_map,
+                                   PGSIZE);
   size_t block_size;
 
-  for (block_size = 16; block_size < PGSIZE / 2; block_size *= 2)
+  arena_map = palloc_get_multiple (PAL_ASSERT | PAL_ZERO, map_pages);
+  for (block_size = 16; block_size <= PGSIZE / 4; block_size *= 2)
+    desc_init (block_size);
+  for (; block_size <= PGSIZE * 2; block_size *= 2)
     {
-      struct desc *d = &descs[desc_cnt++];
-      ASSERT (desc_cnt <= sizeof descs / sizeof *descs);
-      d->block_size = block_size;
-      d->blocks_per_arena = (PGSIZE - sizeof (struct arena)) / block_size;
-      list_init (&d->free_list);
-      lock_init (&d->lock);
+      desc_init (block_size * 3 / 4);
+      desc_init (block_size);
     }
+  desc_init (PGSIZE * 3);
+}
+
+/* Adds a descriptor for blocks of BLOCK_SIZE bytes, in arenas of
+   the fewest pages that waste at most 1/8 of the arena, or of the
+   pages that waste least if no arena of up to ARENA_MAX_PAGES
+   pages is that efficient. */
+static void
+desc_init (size_t block_size) 
+{
+  struct desc *d = &descs[desc_cnt++];
+  size_t page_cnt;
+
+  ASSERT (desc_cnt <= sizeof descs / sizeof *descs);
+  d->block_size = block_size;
+  d->arena_pages = 1;
+  d->blocks_per_arena = 0;
+  for (page_cnt = 1; page_cnt <= ARENA_MAX_PAGES; page_cnt++)
+    {
+      size_t blocks = (PGSIZE * page_cnt - sizeof (struct arena)) / block_size;
+      if (blocks * d->arena_pages > d->blocks_per_arena * page_cnt)
+        {
+          d->arena_pages = page_cnt;
+          d->blocks_per_arena = blocks;
+        }
+      if (blocks * block_size >= PGSIZE * page_cnt / 8 * 7)
+        break;
+    }
+  ASSERT (d->blocks_per_arena > 0);
+  list_init (&d->free_list);
+  lock_init (&d->lock);
+}
+
+/* Returns the smallest descriptor for blocks of at least SIZE
+   bytes, or a null pointer if SIZE is too big for any. */
+static struct desc *
+size_to_desc (size_t size) 
+{
+  struct desc *d;
+
+  for (d = descs; d < descs + desc_cnt; d++)
+    if (d->block_size >= size)
+      return d;
+  return NULL;
 }
 
 /* Obtains and returns a new block of at least SIZE bytes.
@@ -99,10 +169,8 @@ malloc (size_t size)
 
   /* Find the smallest descriptor that satisfies a SIZE-byte
      request. */
-  for (d = descs; d < descs + desc_cnt; d++)
-    if (d->block_size >= size)
-      break;
-  if (d == descs + desc_cnt) 
+  d = size_to_desc (size);
+  if (d == NULL) 
     {
       /* SIZE is too big for any descriptor.
          Allocate enough pages to hold SIZE plus an arena. */
@@ -126,8 +194,8 @@ malloc (size_t size)
     {
       size_t i;
 
-      /* Allocate a page. */
-      a = palloc_get_page (0);
+      /* Allocate the arena's pages. */
+      a = palloc_get_multiple (0, d->arena_pages);
       if (a == NULL) 
         {
           lock_release (&d->lock);
@@ -138,6 +206,8 @@ malloc (size_t size)
       a->magic = ARENA_MAGIC;
       a->desc = d;
       a->free_cnt = d->blocks_per_arena;
+      if (d->arena_pages > 1)
+        arena_map_set (a, d->arena_pages, a);
       for (i = 0; i < d->blocks_per_arena; i++) 
         {
           struct block *b = arena_to_block (a, i);
@@ -199,6 +269,8 @@ realloc (void *old_block, size_t new_size)
       free (old_block);
       return NULL;
     }
+  else if (old_block != NULL && resize_in_place (old_block, new_size))
+    return old_block;
   else 
     {
       void *new_block = malloc (new_size);
@@ -213,6 +285,31 @@ realloc (void *old_block, size_t new_size)
     }
 }
 
+/* Attempts to resize BLOCK to NEW_SIZE bytes without moving it.
+   Returns true if successful, false if BLOCK must be moved. */
+static bool
+resize_in_place (void *block, size_t new_size) 
+{
+  struct arena *a = block_to_arena (block);
+  struct desc *d = size_to_desc (new_size);
+  size_t page_cnt;
+
+  if (a->desc != NULL || d != NULL)
+    return a->desc == d;
+
+  /* Both sizes are big blocks.  Give back or take on pages at
+     the end. */
+  page_cnt = DIV_ROUND_UP (new_size + sizeof *a, PGSIZE);
+  if (page_cnt < a->free_cnt)
+    palloc_free_multiple ((uint8_t *) a + PGSIZE * page_cnt,
+                          a->free_cnt - page_cnt);
+  else if (page_cnt > a->free_cnt
+           && !palloc_extend (a, a->free_cnt, page_cnt))
+    return false;
+  a->free_cnt = page_cnt;
+  return true;
+}
+
 /* Frees block P, which must have been previously allocated with
    malloc(), calloc(), or realloc(). */
 void
@@ -249,7 +346,9 @@ free (void *p)
                   struct block *b = arena_to_block (a, i);
                   list_remove (&b->free_elem);
                 }
-              palloc_free_page (a);
+              if (d->arena_pages > 1)
+                arena_map_set (a, d->arena_pages, NULL);
+              palloc_free_multiple (a, d->arena_pages);
             }
 
           lock_release (&d->lock);
@@ -263,11 +362,26 @@ free (void *p)
     }
 }
 
+/* Sets the ARENA_MAP entries for the PAGE_CNT pages of arena A
+   to VALUE. */
+static void
+arena_map_set (struct arena *a, size_t page_cnt, struct arena *value) 
+{
+  size_t first = vtop (a) >> PGBITS;
+  size_t i;
+
+  for (i = 0; i < page_cnt; i++)
+    arena_map[first + i] = value;
+}
+
 /* Returns the arena that block B is inside. */
 static struct arena *
 block_to_arena (struct block *b)
 {
-  struct arena *a = pg_round_down (b);
+  struct arena *a = arena_map[vtop (b) >> PGBITS];
+
+  if (a == NULL)
+    a = pg_round_down (b);
 
   /* Check that the arena is valid. */
   ASSERT (a != NULL);
@@ -275,7 +389,7 @@ block_to_arena (struct block *b)
 
   /* Check that the block is properly aligned for the arena. */
   ASSERT (a->desc == NULL
-          || (pg_ofs (b) - sizeof *a) % a->desc->block_size == 0);
+          || ((uint8_t *) b - (uint8_t *) (a + 1)) % a->desc->block_size == 0);
   ASSERT (a->desc != NULL || pg_ofs (b) == sizeof *a);
 
   return a;
@@ -2,13 +2,15 @@
 #include <bitmap.h>
 #include <debug.h>
 #include <inttypes.h>
+#include <list.h>
 #include <round.h>
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/interrupt.h"
 #include "threads/loader.h"
-#include "threads/synch.h"
 #include "threads/vaddr.h"
 
 /* Page allocator.  Hands out memory in page-size (or
@@ -23,21 +25,95 @@
 
    By default, half of system RAM is given to the kernel pool and
    half to the user pool.  That should be huge overkill for the
-   kernel pool, but that's just fine for demonstration purposes. */
+   kernel pool, but that's just fine for demonstration purposes.
+
+   So that a skewed workload can still use all of RAM, a pool
+   that runs out borrows free pages from the other one, as long
+   as that leaves the lender above its low watermark, a quarter
+   of its size, which stays reserved for its own use.  Borrowed
+   pages are returned to their own pool when they are freed.
+   The user pool does not borrow if its size was capped with
+   "-ul".
+
+   Within a pool, pages are managed by a binary buddy allocator:
+   free pages form aligned blocks of 2**ORDER pages, kept on one
+   free list per order, and a freed block is merged with its
+   buddy whenever that is free too.  A request for N pages takes
+   a block of the smallest order that fits and returns the pages
+   beyond N to the free lists, so allocating and freeing take
+   time logarithmic in the pool size.  Each free block keeps its
+   list element in its first page.  Operations are short enough
+   to run with interrupts disabled, which also makes it safe for
+   the scheduler to free dead threads' pages.  The pool's bitmap
+   of used pages is kept only to check for double allocation and
+   double freeing.
+
+   Single pages, by far the most common request, usually bypass
+   the buddy lists: each pool keeps a small LIFO cache of
+   recently freed pages, which are still warm in the CPU cache,
+   and refills or drains it from the buddy lists a batch at a
+   time.
+
+   So that PAL_ZERO requests need not clear a page while the
+   caller waits, the idle thread zeroes free pages in the
+   background, calling palloc_prezero_page(), and puts them on a
+   per-pool stack of known-zero pages.  Single-page PAL_ZERO
+   requests take from that stack first; other requests only fall
+   back to it when the rest of the pool is exhausted. */
+
+/* Number of single pages a pool's page cache holds, and number
+   moved between it and the buddy lists at a time. */
+#define PAGE_CACHE_SIZE 32
+#define PAGE_CACHE_BATCH 16
+
+/* Number of pre-zeroed pages a pool keeps. */
+#define ZERO_CACHE_SIZE 32
+
+/* Number of block orders.  The largest block has
+   2**(BUDDY_ORDERS - 1) pages. */
+#define BUDDY_ORDERS 16
+
+/* A pool lends pages only while more than 1/LEND_RESERVE_DIV
+   of its pages stay free. */
+#define LEND_RESERVE_DIV 4
 
 /* A memory pool. */
 struct pool
   {
-    struct lock lock;                   /* Mutual exclusion. */
     struct bitmap *used_map;            /* Bitmap of free pages. */
     uint8_t *base;                      /* Base of pool. */
+    size_t page_cnt;                    /* Number of pages. */
+    uint8_t *free_order;                /* Per page: 1 + order of free
+                                           block starting there, or 0. */
+    struct list free_lists[BUDDY_ORDERS]; /* Free blocks by order. */
+    size_t cache[PAGE_CACHE_SIZE];      /* Cached free pages, by index. */
+    size_t cache_cnt;                   /* Number of cached pages. */
+    size_t zeroed[ZERO_CACHE_SIZE];     /* Pre-zeroed free pages. */
+    size_t zeroed_cnt;                  /* Number of pre-zeroed pages. */
+    size_t free_cnt;                    /* Number of free pages. */
+    size_t reserve;                     /* Low watermark for lending. */
   };
 
 /* Two pools: one for kernel data, one for user pages. */
 static struct pool kernel_pool, user_pool;
 
+/* True if the user pool may borrow from the kernel pool. */
+static bool user_may_borrow;
+
 static void init_pool (struct pool *, void *base, size_t page_cnt,
                        const char *name);
+static void *pool_get (struct pool *, size_t page_cnt, size_t reserve,
+                       bool zero, bool *is_zero);
+static bool pool_prezero (struct pool *);
+static struct list_elem *block_elem (struct pool *, size_t page_idx);
+static size_t buddy_alloc (struct pool *, size_t page_cnt);
+static void buddy_free (struct pool *, size_t page_idx, size_t page_cnt);
+static void block_free (struct pool *, size_t page_idx, int order);
+static void cache_refill (struct pool *);
+static void cache_drain (struct pool *, size_t page_cnt);
+static void zeroed_drain (struct pool *);
+static void page_claim (struct pool *, size_t page_idx);
+static bool index_remove (size_t *, size_t *cnt, size_t page_idx);
 static bool page_from_pool (const struct pool *, void *page);
 
 /* Initializes the page allocator.  At most USER_PAGE_LIMIT
@@ -59,37 +135,42 @@ palloc_init (size_t user_page_limit)
   init_pool (&kernel_pool, free_start, kernel_pages, "kernel pool");
   init_pool (&user_pool, free_start + kernel_pages * PGSIZE,
              user_pages, "user pool");
+  user_may_borrow = user_page_limit == SIZE_MAX;
 }
 
 /* Obtains and returns a group of PAGE_CNT contiguous free pages.
    If PAL_USER is set, the pages are obtained from the user pool,
    otherwise from the kernel pool.  If PAL_ZERO is set in FLAGS,
-   then the pages are filled with zeros.  If too few pages are
-   available, returns a null pointer, unless PAL_ASSERT is set in
-   FLAGS, in which case the kernel panics. */
+   then the pages are filled with zeros.  If the pool has too few
+   pages, they are borrowed from the other pool if it has enough
+   to spare.  If too few pages are available, returns a null
+   pointer, unless PAL_ASSERT is set in FLAGS, in which case the
+   kernel panics. */
 void *
 palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
 {
   struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+  struct pool *lender = flags & PAL_USER ? &kernel_pool : &user_pool;
+  bool zero = (flags & PAL_ZERO) != 0;
+  bool is_zero = false;
   void *pages;
-  size_t page_idx;
 
   if (page_cnt == 0)
     return NULL;
 
-  lock_acquire (&pool->lock);
-  page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
-  lock_release (&pool->lock);
-
-  if (page_idx != BITMAP_ERROR)
-    pages = pool->base + PGSIZE * page_idx;
-  else
-    pages = NULL;
+  pages = pool_get (pool, page_cnt, 0, zero, &is_zero);
+  if (pages == NULL && (pool == &kernel_pool || user_may_borrow))
+    pages = pool_get (lender, page_cnt, lender->reserve, zero, &is_zero);
 
   if (pages != NULL) 
     {
-      if (flags & PAL_ZERO)
-        memset (pages, 0, PGSIZE * page_cnt);
+      if (zero && !is_zero)
+        {
+          size_t i;
+
+          for (i = 0; i < page_cnt; i++)
+            pg_clear ((uint8_t *) pages + PGSIZE * i);
+        }
     }
   else 
     {
@@ -119,6 +200,7 @@ palloc_free_multiple (void *pages, size_t page_cnt)
 {
   struct pool *pool;
   size_t page_idx;
+  enum intr_level old_level;
 
   ASSERT (pg_ofs (pages) == 0);
   if (pages == NULL || page_cnt == 0)
@@ -137,8 +219,19 @@ palloc_free_multiple (void *pages, size_t page_cnt)
   memset (pages, 0xcc, PGSIZE * page_cnt);
 #endif
 
+  old_level = intr_disable ();
   ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
   bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+  if (page_cnt == 1)
+    {
+      if (pool->cache_cnt == PAGE_CACHE_SIZE)
+        cache_drain (pool, PAGE_CACHE_BATCH);
+      pool->cache[pool->cache_cnt++] = page_idx;
+    }
+  else
+    buddy_free (pool, page_idx, page_cnt);
+  pool->free_cnt += page_cnt;
+  intr_set_level (old_level);
 }
 
 /* Frees the page at PAGE. */
@@ -148,15 +241,70 @@ palloc_free_page (void *page)
   palloc_free_multiple (page, 1);
 }
 
+/* Extends the PAGE_CNT pages starting at PAGES, which were
+   obtained together from palloc_get_multiple(), to NEW_PAGE_CNT
+   pages by allocating the pages that follow them.  Returns true
+   if successful, false if any of those pages is in use or in
+   another pool, in which case nothing changes. */
+bool
+palloc_extend (void *pages, size_t page_cnt, size_t new_page_cnt)
+{
+  struct pool *pool;
+  size_t extra_idx, extra_cnt, i;
+  enum intr_level old_level;
+  bool success;
+
+  ASSERT (pg_ofs (pages) == 0);
+  ASSERT (new_page_cnt >= page_cnt);
+
+  if (page_from_pool (&kernel_pool, pages))
+    pool = &kernel_pool;
+  else if (page_from_pool (&user_pool, pages))
+    pool = &user_pool;
+  else
+    NOT_REACHED ();
+
+  extra_idx = pg_no (pages) - pg_no (pool->base) + page_cnt;
+  extra_cnt = new_page_cnt - page_cnt;
+
+  old_level = intr_disable ();
+  success = (extra_idx + extra_cnt <= pool->page_cnt
+             && pool->free_cnt >= extra_cnt
+             && bitmap_none (pool->used_map, extra_idx, extra_cnt));
+  if (success)
+    {
+      for (i = 0; i < extra_cnt; i++)
+        page_claim (pool, extra_idx + i);
+      bitmap_set_multiple (pool->used_map, extra_idx, extra_cnt, true);
+      pool->free_cnt -= extra_cnt;
+    }
+  intr_set_level (old_level);
+
+  return success;
+}
+
+/* Zeroes one free page, if some pool has a free page and room
+   for another pre-zeroed page, for later PAL_ZERO requests to
+   use.  Returns true if a page was zeroed, false if there was
+   nothing to do.  Called by the idle thread. */
+bool
+palloc_prezero_page (void)
+{
+  return pool_prezero (&user_pool) || pool_prezero (&kernel_pool);
+}
+
 /* Initializes pool P as starting at START and ending at END,
    naming it NAME for debugging purposes. */
 static void
 init_pool (struct pool *p, void *base, size_t page_cnt, const char *name) 
 {
-  /* We'll put the pool's used_map at its base.
-     Calculate the space needed for the bitmap
-     and subtract it from the pool's size. */
-  size_t bm_pages = DIV_ROUND_UP (bitmap_buf_size (page_cnt), PGSIZE);
+  /* We'll put the pool's used_map and free_order at its base.
+     Calculate the space needed for them and subtract it from
+     the pool's size. */
+  size_t bm_size = bitmap_buf_size (page_cnt);
+  size_t bm_pages = DIV_ROUND_UP (bm_size + page_cnt, PGSIZE);
+  int order;
+
   if (bm_pages > page_cnt)
     PANIC ("Not enough memory in %s for bitmap.", name);
   page_cnt -= bm_pages;
@@ -164,9 +312,293 @@ init_pool (struct pool *p, void *base, size_t page_cnt, const char *name)
   printf ("%zu pages available in %s.\n", page_cnt, name);
 
   /* Initialize the pool. */
-  lock_init (&p->lock);
-  p->used_map = bitmap_create_in_buf (page_cnt, base, bm_pages * PGSIZE);
+  p->used_map = bitmap_create_in_buf (page_cnt, base, bm_size);
+  p->free_order = (uint8_t *) base + bm_size;
+  memset (p->free_order, 0, page_cnt);
   p->base = base + bm_pages * PGSIZE;
+  p->page_cnt = page_cnt;
+  for (order = 0; order < BUDDY_ORDERS; order++)
+    list_init (&p->free_lists[order]);
+  p->cache_cnt = 0;
+  p->zeroed_cnt = 0;
+  buddy_free (p, 0, page_cnt);
+  p->free_cnt = page_cnt;
+  p->reserve = page_cnt / LEND_RESERVE_DIV;
+}
+
+/* Allocates PAGE_CNT contiguous pages from POOL, provided that
+   at least RESERVE of its pages stay free, and returns the first
+   one.  Returns a null pointer on failure.  If ZERO is true, a
+   single page is taken from the pre-zeroed pages if there are
+   any.  Sets *IS_ZERO to true if the pages returned are known to
+   be zeroed. */
+static void *
+pool_get (struct pool *pool, size_t page_cnt, size_t reserve,
+          bool zero, bool *is_zero)
+{
+  size_t page_idx = BITMAP_ERROR;
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  if (pool->free_cnt >= page_cnt + reserve)
+    {
+      if (page_cnt == 1)
+        {
+          if (!zero || pool->zeroed_cnt == 0)
+            {
+              if (pool->cache_cnt == 0)
+                cache_refill (pool);
+              if (pool->cache_cnt > 0)
+                page_idx = pool->cache[--pool->cache_cnt];
+            }
+          if (page_idx == BITMAP_ERROR && pool->zeroed_cnt > 0)
+            {
+              page_idx = pool->zeroed[--pool->zeroed_cnt];
+              *is_zero = true;
+            }
+        }
+      else
+        {
+          page_idx = buddy_alloc (pool, page_cnt);
+          if (page_idx == BITMAP_ERROR
+              && (pool->cache_cnt > 0 || pool->zeroed_cnt > 0))
+            {
+              /* Cached pages may be what keeps the buddy lists
+                 from having a big enough block. */
+              cache_drain (pool, pool->cache_cnt);
+              zeroed_drain (pool);
+              page_idx = buddy_alloc (pool, page_cnt);
+            }
+        }
+      if (page_idx != BITMAP_ERROR)
+        {
+          ASSERT (bitmap_none (pool->used_map, page_idx, page_cnt));
+          bitmap_set_multiple (pool->used_map, page_idx, page_cnt, true);
+          pool->free_cnt -= page_cnt;
+        }
+    }
+  intr_set_level (old_level);
+
+  return page_idx != BITMAP_ERROR ? pool->base + PGSIZE * page_idx : NULL;
+}
+
+/* Takes a free page out of POOL, zeroes it with interrupts
+   enabled, and pushes it onto POOL's pre-zeroed pages.  Returns
+   false without doing anything if there are enough pre-zeroed
+   pages already or no free page to zero.  The page is marked
+   used while it is being zeroed, so that nothing else can
+   allocate it. */
+static bool
+pool_prezero (struct pool *pool)
+{
+  size_t page_idx = BITMAP_ERROR;
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  if (pool->zeroed_cnt < ZERO_CACHE_SIZE)
+    {
+      /* Prefer cold pages, leaving the warm cached ones for
+         callers that are about to overwrite them anyway. */
+      page_idx = buddy_alloc (pool, 1);
+      if (page_idx == BITMAP_ERROR && pool->cache_cnt > 0)
+        page_idx = pool->cache[--pool->cache_cnt];
+      if (page_idx != BITMAP_ERROR)
+        {
+          bitmap_mark (pool->used_map, page_idx);
+          pool->free_cnt--;
+        }
+    }
+  intr_set_level (old_level);
+  if (page_idx == BITMAP_ERROR)
+    return false;
+
+  pg_clear (pool->base + PGSIZE * page_idx);
+
+  old_level = intr_disable ();
+  bitmap_reset (pool->used_map, page_idx);
+  pool->free_cnt++;
+  if (pool->zeroed_cnt < ZERO_CACHE_SIZE)
+    pool->zeroed[pool->zeroed_cnt++] = page_idx;
+  else
+    buddy_free (pool, page_idx, 1);
+  intr_set_level (old_level);
+  return true;
+}
+
+/* Moves up to PAGE_CACHE_BATCH single pages from P's buddy
+   lists into its page cache, which must be empty. */
+static void
+cache_refill (struct pool *p)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (p->cache_cnt == 0);
+
+  while (p->cache_cnt < PAGE_CACHE_BATCH)
+    {
+      size_t page_idx = buddy_alloc (p, 1);
+      if (page_idx == BITMAP_ERROR)
+        break;
+      p->cache[p->cache_cnt++] = page_idx;
+    }
+}
+
+/* Returns the PAGE_CNT least recently freed pages in P's page
+   cache to its buddy lists. */
+static void
+cache_drain (struct pool *p, size_t page_cnt)
+{
+  size_t i;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (page_cnt <= p->cache_cnt);
+
+  for (i = 0; i < page_cnt; i++)
+    buddy_free (p, p->cache[i], 1);
+  p->cache_cnt -= page_cnt;
+  memmove (p->cache, p->cache + page_cnt, p->cache_cnt * sizeof *p->cache);
+}
+
+/* Returns all of P's pre-zeroed pages to its buddy lists. */
+static void
+zeroed_drain (struct pool *p)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  while (p->zeroed_cnt > 0)
+    buddy_free (p, p->zeroed[--p->zeroed_cnt], 1);
+}
+
+/* Takes free page PAGE_IDX out of P's page cache, pre-zeroed
+   pages, or the free block that contains it, whichever it is
+   in.  The rest of such a block goes back to the free lists. */
+static void
+page_claim (struct pool *p, size_t page_idx)
+{
+  int order;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (index_remove (p->cache, &p->cache_cnt, page_idx)
+      || index_remove (p->zeroed, &p->zeroed_cnt, page_idx))
+    return;
+  for (order = 0; order < BUDDY_ORDERS; order++)
+    {
+      size_t size = (size_t) 1 << order;
+      size_t start = page_idx & ~(size - 1);
+
+      if (p->free_order[start] == order + 1)
+        {
+          list_remove (block_elem (p, start));
+          p->free_order[start] = 0;
+          buddy_free (p, start, page_idx - start);
+          buddy_free (p, page_idx + 1, start + size - (page_idx + 1));
+          return;
+        }
+    }
+  NOT_REACHED ();
+}
+
+/* Removes PAGE_IDX, if present, from the *CNT page indexes in
+   ARRAY, keeping the others in order.  Returns true if it was
+   present. */
+static bool
+index_remove (size_t *array, size_t *cnt, size_t page_idx)
+{
+  size_t i;
+
+  for (i = 0; i < *cnt; i++)
+    if (array[i] == page_idx)
+      {
+        (*cnt)--;
+        memmove (array + i, array + i + 1, (*cnt - i) * sizeof *array);
+        return true;
+      }
+  return false;
+}
+
+/* Returns the list element kept in the first page of the block
+   at PAGE_IDX in P. */
+static struct list_elem *
+block_elem (struct pool *p, size_t page_idx)
+{
+  return (struct list_elem *) (p->base + PGSIZE * page_idx);
+}
+
+/* Takes PAGE_CNT contiguous pages off P's free lists and returns
+   the index of the first, or BITMAP_ERROR if there is no free
+   block big enough. */
+static size_t
+buddy_alloc (struct pool *p, size_t page_cnt)
+{
+  int want, order;
+  size_t page_idx;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  for (want = 0; want < BUDDY_ORDERS && ((size_t) 1 << want) < page_cnt;
+       want++)
+    continue;
+  for (order = want; order < BUDDY_ORDERS; order++)
+    if (!list_empty (&p->free_lists[order]))
+      break;
+  if (order >= BUDDY_ORDERS)
+    return BITMAP_ERROR;
+
+  page_idx = ((uint8_t *) list_pop_front (&p->free_lists[order]) - p->base)
+             / PGSIZE;
+  p->free_order[page_idx] = 0;
+
+  /* Split down to the order wanted, freeing the upper halves,
+     then give back the pages beyond PAGE_CNT. */
+  while (order > want)
+    {
+      order--;
+      block_free (p, page_idx + ((size_t) 1 << order), order);
+    }
+  buddy_free (p, page_idx + page_cnt, ((size_t) 1 << want) - page_cnt);
+  return page_idx;
+}
+
+/* Returns the PAGE_CNT pages starting at PAGE_IDX to P's free
+   lists, as the largest aligned blocks that they divide into. */
+static void
+buddy_free (struct pool *p, size_t page_idx, size_t page_cnt)
+{
+  while (page_cnt > 0)
+    {
+      int order = 0;
+
+      while (order + 1 < BUDDY_ORDERS
+             && page_idx % ((size_t) 1 << (order + 1)) == 0
+             && ((size_t) 1 << (order + 1)) <= page_cnt)
+        order++;
+      block_free (p, page_idx, order);
+      page_idx += (size_t) 1 << order;
+      page_cnt -= (size_t) 1 << order;
+    }
+}
+
+/* Frees the block of 2**ORDER pages at PAGE_IDX in P, merging it
+   with its buddy as long as the buddy is free. */
+static void
+block_free (struct pool *p, size_t page_idx, int order)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  while (order + 1 < BUDDY_ORDERS)
+    {
+      size_t size = (size_t) 1 << order;
+      size_t buddy = page_idx ^ size;
+
+      if (buddy + size > p->page_cnt || p->free_order[buddy] != order + 1)
+        break;
+      list_remove (block_elem (p, buddy));
+      p->free_order[buddy] = 0;
+      page_idx &= ~size;
+      order++;
+    }
+  p->free_order[page_idx] = order + 1;
+  list_push_front (&p->free_lists[order], block_elem (p, page_idx));
 }
 
 /* Returns true if PAGE was allocated from POOL,
@@ -0,0 +1,201 @@
+#include "threads/slab.h"
+#include <debug.h>
+#include <round.h>
+#include <stdint.h>
+#include <string.h>
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* Slab allocator.
+
+   Each slab is one page from the page allocator, starting with
+   a struct slab header followed by as many objects as fit.  The
+   free objects of a slab form a singly linked list threaded
+   through the objects themselves, at the cache's LINK_OFS.  An
+   object's slab is found by rounding its address down to a page
+   boundary, so freeing needs no search. */
+
+/* Magic number for detecting slab corruption. */
+#define SLAB_MAGIC 0x51ab51ab
+
+/* Slab. */
+struct slab
+  {
+    unsigned magic;                     /* Always set to SLAB_MAGIC. */
+    struct kmem_cache *cache;           /* Owning cache. */
+    struct list_elem elem;              /* Element in PARTIAL or FULL. */
+    size_t in_use;                      /* Number of allocated objects. */
+    void *free_list;                    /* First free object. */
+  };
+
+/* Offset of the first object in a slab. */
+#define SLAB_HEADER ROUND_UP (sizeof (struct slab), sizeof (void *))
+
+static struct slab *slab_create (struct kmem_cache *);
+static struct slab *obj_to_slab (struct kmem_cache *, void *);
+static void **obj_link (struct kmem_cache *, void *);
+
+/* Initializes C as a cache of objects SIZE bytes long, named
+   NAME for debugging purposes.  If CTOR is nonnull, it is
+   applied to each object when its slab is created. */
+void
+kmem_cache_init (struct kmem_cache *c, const char *name, size_t size,
+                 void (*ctor) (void *))
+{
+  ASSERT (size > 0);
+
+  /* Objects hold a free list link while free, and are aligned
+     for one. */
+  size = ROUND_UP (size, sizeof (void *));
+  c->link_ofs = ctor != NULL ? size : 0;
+  if (ctor != NULL)
+    size += sizeof (void *);
+  ASSERT (size <= PGSIZE - SLAB_HEADER);
+
+  c->name = name;
+  c->obj_size = size;
+  c->objs_per_slab = (PGSIZE - SLAB_HEADER) / size;
+  c->ctor = ctor;
+  list_init (&c->partial);
+  list_init (&c->full);
+  c->spare = NULL;
+  lock_init (&c->lock);
+}
+
+/* Obtains and returns a new object from cache C.  Returns a null
+   pointer if memory is not available. */
+void *
+kmem_cache_alloc (struct kmem_cache *c)
+{
+  struct slab *s;
+  void *obj;
+
+  lock_acquire (&c->lock);
+  if (!list_empty (&c->partial))
+    s = list_entry (list_front (&c->partial), struct slab, elem);
+  else
+    {
+      if (c->spare != NULL)
+        {
+          s = c->spare;
+          c->spare = NULL;
+        }
+      else
+        {
+          s = slab_create (c);
+          if (s == NULL)
+            {
+              lock_release (&c->lock);
+              return NULL;
+            }
+        }
+      list_push_front (&c->partial, &s->elem);
+    }
+
+  /* Take an object off the slab's free list, moving the slab to
+     FULL if that was its last one. */
+  obj = s->free_list;
+  s->free_list = *obj_link (c, obj);
+  if (++s->in_use == c->objs_per_slab)
+    {
+      list_remove (&s->elem);
+      list_push_front (&c->full, &s->elem);
+    }
+  lock_release (&c->lock);
+  return obj;
+}
+
+/* Returns object P, which must have been allocated from cache C
+   with kmem_cache_alloc(), to C. */
+void
+kmem_cache_free (struct kmem_cache *c, void *p)
+{
+  struct slab *s;
+
+  if (p == NULL)
+    return;
+  s = obj_to_slab (c, p);
+
+#ifndef NDEBUG
+  /* Clear the object to help detect use-after-free bugs, unless
+     it must keep its constructed state. */
+  if (c->ctor == NULL)
+    memset (p, 0xcc, c->obj_size);
+#endif
+
+  lock_acquire (&c->lock);
+  ASSERT (s->in_use > 0);
+  if (s->in_use-- == c->objs_per_slab)
+    {
+      list_remove (&s->elem);
+      list_push_front (&c->partial, &s->elem);
+    }
+  *obj_link (c, p) = s->free_list;
+  s->free_list = p;
+
+  /* Keep one empty slab in reserve and give others back to the
+     page allocator. */
+  if (s->in_use == 0)
+    {
+      list_remove (&s->elem);
+      if (c->spare == NULL)
+        c->spare = s;
+      else
+        palloc_free_page (s);
+    }
+  lock_release (&c->lock);
+}
+
+/* Allocates a new slab for cache C, with all of its objects free
+   and constructed.  Returns a null pointer if memory is not
+   available. */
+static struct slab *
+slab_create (struct kmem_cache *c)
+{
+  struct slab *s = palloc_get_page (0);
+  uint8_t *first;
+  size_t i;
+
+  if (s == NULL)
+    return NULL;
+  s->magic = SLAB_MAGIC;
+  s->cache = c;
+  s->in_use = 0;
+  s->free_list = NULL;
+
+  /* Push the objects in reverse order, so that they are handed
+     out in address order. */
+  first = (uint8_t *) s + SLAB_HEADER;
+  for (i = c->objs_per_slab; i-- > 0; )
+    {
+      void *obj = first + i * c->obj_size;
+      if (c->ctor != NULL)
+        c->ctor (obj);
+      *obj_link (c, obj) = s->free_list;
+      s->free_list = obj;
+    }
+  return s;
+}
+
+/* Returns the slab that object P of cache C is in. */
+static struct slab *
+obj_to_slab (struct kmem_cache *c, void *p)
+{
+  struct slab *s = pg_round_down (p);
+
+  /* Check that the slab is valid and belongs to C. */
+  ASSERT (s->magic == SLAB_MAGIC);
+  ASSERT (s->cache == c);
+
+  /* Check that the object is properly aligned for the slab. */
+  ASSERT ((pg_ofs (p) - SLAB_HEADER) % c->obj_size == 0);
+
+  return s;
+}
+
+/* Returns the free list link of object P of cache C. */
+static void **
+obj_link (struct kmem_cache *c, void *p)
+{
+  return (void **) ((uint8_t *) p + c->link_ofs);
+}
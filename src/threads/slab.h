@@ -0,0 +1,42 @@
+#ifndef THREADS_SLAB_H
+#define THREADS_SLAB_H
+
+#include <list.h>
+#include <stddef.h>
+#include "threads/synch.h"
+
+/* Object cache.
+
+   A cache hands out objects of a single size, packed into
+   page-size "slabs" without rounding the size up to a power of
+   2 the way malloc() does.  Slabs with free objects are kept on
+   PARTIAL, slabs without on FULL, and at most one slab with no
+   objects allocated is kept in reserve as SPARE, so that a
+   workload that allocates and frees around a slab boundary does
+   not go back to the page allocator every time.  Each cache has
+   its own lock, so unrelated kinds of objects do not contend.
+
+   If CTOR is nonnull, it is called on every object when its slab
+   is created, and objects must be returned to the cache in their
+   constructed state, so that allocation need not repeat the
+   work.  Such objects get an extra word past their end for the
+   free list link, so that it does not clobber that state. */
+struct kmem_cache
+  {
+    const char *name;                   /* Name, for debugging. */
+    size_t obj_size;                    /* Size of each object. */
+    size_t link_ofs;                    /* Offset of free list link. */
+    size_t objs_per_slab;               /* Number of objects in a slab. */
+    void (*ctor) (void *);              /* Constructor, or NULL. */
+    struct list partial;                /* Slabs with free objects. */
+    struct list full;                   /* Slabs with no free objects. */
+    struct slab *spare;                 /* Empty slab kept in reserve. */
+    struct lock lock;                   /* Protects the above. */
+  };
+
+void kmem_cache_init (struct kmem_cache *, const char *name, size_t size,
+                      void (*ctor) (void *));
+void *kmem_cache_alloc (struct kmem_cache *) __attribute__ ((malloc));
+void kmem_cache_free (struct kmem_cache *, void *);
+
+#endif /* threads/slab.h */
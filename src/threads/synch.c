@@ -336,3 +336,187 @@ cond_broadcast (struct condition *cond, struct lock *lock)
   while (!list_empty (&cond->waiters))
     cond_signal (cond, lock);
 }
+
+/* Initializes RW as a reader-writer lock.  Any number of
+   readers, or a single writer, may hold the lock at a time.
+   Like locks, reader-writer locks are not recursive: a thread
+   must not acquire RW again, for reading or writing, while it
+   holds it.
+
+   Writers take preference over readers: while a writer waits,
+   newly arriving readers wait behind it, so that a steady stream
+   of readers cannot starve writers.  (Readers may be starved by
+   a steady stream of writers instead, which is the better
+   failure for read-mostly data.) */
+void
+rwlock_init (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+
+  lock_init (&rw->lock);
+  cond_init (&rw->can_read);
+  cond_init (&rw->can_write);
+  cond_init (&rw->can_upgrade);
+  rw->readers = 0;
+  rw->waiting_writers = 0;
+  rw->writer = NULL;
+  rw->upgrader = NULL;
+}
+
+/* Acquires RW for reading, sleeping until no writer holds it,
+   waits for it, or is upgrading to it.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_read_acquire (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+  ASSERT (!intr_context ());
+
+  lock_acquire (&rw->lock);
+  while (rw->writer != NULL || rw->waiting_writers > 0
+         || rw->upgrader != NULL)
+    cond_wait (&rw->can_read, &rw->lock);
+  rw->readers++;
+  lock_release (&rw->lock);
+}
+
+/* Releases RW, which the current thread must hold for
+   reading. */
+void
+rwlock_read_release (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+
+  lock_acquire (&rw->lock);
+  ASSERT (rw->readers > 0);
+  ASSERT (rw->upgrader != thread_current ());
+  rw->readers--;
+  if (rw->upgrader != NULL)
+    {
+      if (rw->readers == 1)
+        cond_signal (&rw->can_upgrade, &rw->lock);
+    }
+  else if (rw->readers == 0)
+    cond_signal (&rw->can_write, &rw->lock);
+  lock_release (&rw->lock);
+}
+
+/* Acquires RW for writing, sleeping until no other thread holds
+   it.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_write_acquire (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+  ASSERT (!intr_context ());
+  ASSERT (!rwlock_held_for_write (rw));
+
+  lock_acquire (&rw->lock);
+  rw->waiting_writers++;
+  while (rw->writer != NULL || rw->readers > 0 || rw->upgrader != NULL)
+    cond_wait (&rw->can_write, &rw->lock);
+  rw->waiting_writers--;
+  rw->writer = thread_current ();
+  lock_release (&rw->lock);
+}
+
+/* Releases RW, which the current thread must hold for writing.
+   Hands RW to the next waiting writer, if there is one, and
+   otherwise to all the waiting readers. */
+void
+rwlock_write_release (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+
+  lock_acquire (&rw->lock);
+  ASSERT (rw->writer == thread_current ());
+  rw->writer = NULL;
+  if (rw->waiting_writers > 0)
+    cond_signal (&rw->can_write, &rw->lock);
+  else
+    cond_broadcast (&rw->can_read, &rw->lock);
+  lock_release (&rw->lock);
+}
+
+/* Converts the current thread's hold on RW from reading to
+   writing, sleeping until the other readers have left.  The
+   upgrading reader goes ahead of any waiting writers.
+
+   Only one reader can wait to upgrade at a time, since two would
+   each wait for the other to leave.  If another reader is
+   already upgrading, the current thread instead releases its
+   read hold and acquires RW for writing like any other writer.
+   In that case other writers may have modified the protected
+   data in between, which the caller must recheck.  Returns true
+   if RW was upgraded without any writer getting in first, false
+   otherwise.  Either way, the current thread holds RW for
+   writing on return.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+bool
+rwlock_upgrade (struct rwlock *rw)
+{
+  bool atomic;
+
+  ASSERT (rw != NULL);
+  ASSERT (!intr_context ());
+
+  lock_acquire (&rw->lock);
+  ASSERT (rw->readers > 0 && rw->writer == NULL);
+  if (rw->upgrader == NULL)
+    {
+      rw->upgrader = thread_current ();
+      while (rw->readers > 1)
+        cond_wait (&rw->can_upgrade, &rw->lock);
+      rw->upgrader = NULL;
+      rw->readers = 0;
+      atomic = true;
+    }
+  else
+    {
+      if (--rw->readers == 1)
+        cond_signal (&rw->can_upgrade, &rw->lock);
+      rw->waiting_writers++;
+      while (rw->writer != NULL || rw->readers > 0 || rw->upgrader != NULL)
+        cond_wait (&rw->can_write, &rw->lock);
+      rw->waiting_writers--;
+      atomic = false;
+    }
+  rw->writer = thread_current ();
+  lock_release (&rw->lock);
+
+  return atomic;
+}
+
+/* Converts the current thread's hold on RW from writing to
+   reading, without letting any writer in between.  Waiting
+   readers are let in as well, unless a writer is waiting. */
+void
+rwlock_downgrade (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+
+  lock_acquire (&rw->lock);
+  ASSERT (rw->writer == thread_current ());
+  rw->writer = NULL;
+  rw->readers++;
+  if (rw->waiting_writers == 0)
+    cond_broadcast (&rw->can_read, &rw->lock);
+  lock_release (&rw->lock);
+}
+
+/* Returns true if the current thread holds RW for writing, false
+   otherwise.  (Readers are not tracked individually, so there is
+   no such test for reading.) */
+bool
+rwlock_held_for_write (const struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+
+  return rw->writer == thread_current ();
+}
@@ -42,6 +42,32 @@ void cond_wait (struct condition *, struct lock *);
 void cond_signal (struct condition *, struct lock *);
 void cond_broadcast (struct condition *, struct lock *);
 
+/* Reader-writer lock.
+
+   Any number of readers, or a single writer, may hold the lock.
+   Writers take preference: once a writer is waiting, new readers
+   wait behind it. */
+struct rwlock
+  {
+    struct lock lock;               /* Protects the members below. */
+    struct condition can_read;      /* Readers may enter. */
+    struct condition can_write;     /* A writer may enter. */
+    struct condition can_upgrade;   /* UPGRADER is the only reader. */
+    unsigned readers;               /* Number of readers holding it. */
+    unsigned waiting_writers;       /* Number of writers waiting. */
+    struct thread *writer;          /* Writer holding it, if any. */
+    struct thread *upgrader;        /* Reader waiting to upgrade. */
+  };
+
+void rwlock_init (struct rwlock *);
+void rwlock_read_acquire (struct rwlock *);
+void rwlock_read_release (struct rwlock *);
+void rwlock_write_acquire (struct rwlock *);
+void rwlock_write_release (struct rwlock *);
+bool rwlock_upgrade (struct rwlock *);
+void rwlock_downgrade (struct rwlock *);
+bool rwlock_held_for_write (const struct rwlock *);
+
 /* Optimization barrier.
 
    The compiler will not reorder operations across an
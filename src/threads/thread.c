@@ -21,8 +21,9 @@
 #define THREAD_MAGIC 0xcd6abf4b
 
 /* List of processes in THREAD_READY state, that is, processes
-   that are ready to run but not actually running. */
-static struct list ready_list;
+   that are ready to run but not actually running.  Counted, so
+   that thread_ready_count() need not walk it. */
+static struct clist ready_list;
 
 /* List of all processes.  Processes are added to this list
    when they are first scheduled and removed when they exit. */
@@ -90,7 +91,7 @@ thread_init (void)
   ASSERT (intr_get_level () == INTR_OFF);
 
   lock_init (&tid_lock);
-  list_init (&ready_list);
+  clist_init (&ready_list);
   list_init (&all_list);
 
   /* Set up a thread structure for the running thread. */
@@ -237,7 +238,7 @@ thread_unblock (struct thread *t)
 
   old_level = intr_disable ();
   ASSERT (t->status == THREAD_BLOCKED);
-  list_push_back (&ready_list, &t->elem);
+  clist_push_back (&ready_list, &t->elem);
   t->status = THREAD_READY;
   intr_set_level (old_level);
 }
@@ -308,7 +309,7 @@ thread_yield (void)
 
   old_level = intr_disable ();
   if (cur != idle_thread) 
-    list_push_back (&ready_list, &cur->elem);
+    clist_push_back (&ready_list, &cur->elem);
   cur->status = THREAD_READY;
   schedule ();
   intr_set_level (old_level);
@@ -331,6 +332,18 @@ thread_foreach (thread_action_func *func, void *aux)
     }
 }
 
+/* Returns the number of threads ready to run, not counting the
+   running thread.  Runs in O(1), so that it can be called on
+   every timer tick, e.g. to compute the MLFQS load average.
+   This function must be called with interrupts off. */
+size_t
+thread_ready_count (void)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  return clist_size (&ready_list);
+}
+
 /* Sets the current thread's priority to NEW_PRIORITY. */
 void
 thread_set_priority (int new_priority) 
@@ -394,6 +407,12 @@ idle (void *idle_started_ UNUSED)
 
   for (;;) 
     {
+      /* Zero free pages ahead of PAL_ZERO requests, one at a
+         time so that a thread that becomes ready is not kept
+         waiting for long. */
+      while (clist_empty (&ready_list) && palloc_prezero_page ())
+        continue;
+
       /* Let someone else run. */
       intr_disable ();
       thread_block ();
@@ -463,6 +482,9 @@ init_thread (struct thread *t, const char *name, int priority)
   t->stack = (uint8_t *) t + PGSIZE;
   t->priority = priority;
   t->magic = THREAD_MAGIC;
+#ifdef VM
+  list_init (&t->mmap_list);
+#endif
 
   old_level = intr_disable ();
   list_push_back (&all_list, &t->allelem);
@@ -490,10 +512,10 @@ alloc_frame (struct thread *t, size_t size)
 static struct thread *
 next_thread_to_run (void) 
 {
-  if (list_empty (&ready_list))
+  if (clist_empty (&ready_list))
     return idle_thread;
   else
-    return list_entry (list_pop_front (&ready_list), struct thread, elem);
+    return list_entry (clist_pop_front (&ready_list), struct thread, elem);
 }
 
 /* Completes a thread switch by activating the new thread's page
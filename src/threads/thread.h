@@ -5,6 +5,9 @@
 #include <hash.h>
 #include <list.h>
 #include <stdint.h>
+#ifdef VM
+#include <user/vmstat.h>
+#endif
 
 /* States in a thread's life cycle. */
 enum thread_status
@@ -99,9 +102,12 @@ struct thread
     uint32_t *pagedir;                  /* Page directory. */
 
 #ifdef VM
-   struct hash page_table;             /* Supplemental page table. */
+   struct page ***page_table;          /* Supplemental page table. */
    int max_mapid;                      /*The largest mapping identifier*/
    struct list mmap_list;              /*list of memory mapped files*/
+   struct file *exec_file;             /* Executable, open while running. */
+   void *user_esp;                     /* User stack pointer in a syscall. */
+   struct vmstat vmstat;               /* Virtual memory statistics. */
 #endif
     int max_fd;                         /* The largest file descriptor. */
     struct list fd_list;                /* List of file descriptors. */
@@ -143,6 +149,7 @@ void thread_yield (void);
 /* Performs some operation on thread t, given auxiliary data AUX. */
 typedef void thread_action_func (struct thread *t, void *aux);
 void thread_foreach (thread_action_func *, void *);
+size_t thread_ready_count (void);
 
 int thread_get_priority (void);
 void thread_set_priority (int);
@@ -4,6 +4,7 @@
 #include <debug.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 
 #include "threads/loader.h"
 
@@ -40,6 +41,29 @@ static inline void *pg_round_down (const void *va) {
   return (void *) ((uintptr_t) va & ~PGMASK);
 }
 
+/* Copies the page at SRC to the page at DST, both page-aligned,
+   a word at a time without memcpy()'s alignment checks. */
+static inline void
+pg_copy (void *dst, const void *src)
+{
+  size_t cnt = PGSIZE / 4;
+
+  ASSERT (pg_ofs (dst) == 0 && pg_ofs (src) == 0);
+  asm volatile ("rep movsl" : "+D" (dst), "+S" (src), "+c" (cnt)
+                : : "memory");
+}
+
+/* Fills the page-aligned page at PAGE with zeros. */
+static inline void
+pg_clear (void *page)
+{
+  size_t cnt = PGSIZE / 4;
+
+  ASSERT (pg_ofs (page) == 0);
+  asm volatile ("rep stosl" : "+D" (page), "+c" (cnt) : "a" (0)
+                : "memory");
+}
+
 /* Base address of the 1:1 physical-to-virtual mapping.  Physical
    memory is mapped starting at this virtual address.  Thus,
    physical address 0 is accessible at PHYS_BASE, physical
@@ -2,6 +2,7 @@
 #include <inttypes.h>
 #include <stdio.h>
 #include "userprog/gdt.h"
+#include "userprog/syscall.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
@@ -9,6 +10,7 @@
 #include <stdint.h>
 #include "userprog/pagedir.h"
 #include "vm/frame.h"
+#include "vm/mmap.h"
 #include "vm/page.h"
 #endif
 /* Number of page faults processed. */
@@ -135,8 +137,8 @@ page_fault (struct intr_frame *f)
 #ifdef VM
   struct thread *t;
   struct page *page;
+  struct mmap_region *region;
   uint8_t *upage;
-  uint8_t *kpage;
   bool success = false;
 #endif
   /* Obtain faulting address, the virtual address that was
@@ -167,32 +169,49 @@ page_fault (struct intr_frame *f)
 
       /* Check supplemental page table. */
       vm_frame_acquire ();
-      page = vm_page_find (&t->page_table, upage);
+      page = vm_page_find (t, upage);
+      if (page == NULL && (region = vm_mmap_find (t, upage)) != NULL)
+        page = vm_mmap_add_page (region, upage);
       if (page != NULL)
         {
           /* Swap. */
           if (!page->valid)
-            success = vm_page_load_swap (page);
+            success = vm_page_load_swap (page, write);
           else if (!page->loaded)
             {
               /* File. */
               if (page->file != NULL)
-                success = vm_page_load_file (page);
+                success = vm_page_load_file (page, write);
               /* Zero. */
               else
-                success = vm_page_load_zero (page);
+                success = vm_page_load_zero (page, write);
 
               if (success)
                 page->loaded = true;
             }
-
-          if (success)
-            {
-              vm_frame_release ();
-              return;
-            }
         }
+      /* Stack growth.  A fault in the kernel comes from a system
+         call, so use the stack pointer saved on entry to it. */
+      else if (vm_page_is_stack_access (fault_addr,
+                                        user ? f->esp : t->user_esp))
+        success = vm_page_grow_stack (upage);
+      vm_frame_release ();
+      if (success)
+        return;
+    }
+  else if (write && is_user_vaddr (fault_addr))
+    {
+      t = thread_current ();
+      upage = pg_round_down (fault_addr);
+
+      /* Copy on write. */
+      vm_frame_acquire ();
+      page = vm_page_find (t, upage);
+      if (page != NULL)
+        success = vm_page_copy_on_write (page);
       vm_frame_release ();
+      if (success)
+        return;
     }
 #endif
    if (not_present || write || user)
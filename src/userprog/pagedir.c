@@ -8,17 +8,25 @@
 
 static uint32_t *active_pd (void);
 static void invalidate_pagedir (uint32_t *);
+static void invalidate_page (uint32_t *, const void *);
 
 /* Creates a new page directory that has mappings for kernel
    virtual addresses, but none for user virtual addresses.
    Returns the new page directory, or a null pointer if memory
-   allocation fails. */
+   allocation fails.  The kernel PDEs, including any 4 MB pages,
+   are copied from the initial page directory, so the kernel's
+   page tables are shared by every process. */
 uint32_t *
 pagedir_create (void) 
 {
   uint32_t *pd = palloc_get_page (0);
   if (pd != NULL)
-    memcpy (pd, init_page_dir, PGSIZE);
+    {
+      size_t kernel_pde = pd_no (PHYS_BASE);
+      memset (pd, 0, kernel_pde * sizeof *pd);
+      memcpy (pd + kernel_pde, init_page_dir + kernel_pde,
+              PGSIZE - kernel_pde * sizeof *pd);
+    }
   return pd;
 }
 
@@ -152,7 +160,7 @@ pagedir_clear_page (uint32_t *pd, void *upage)
   if (pte != NULL && (*pte & PTE_P) != 0)
     {
       *pte &= ~PTE_P;
-      invalidate_pagedir (pd);
+      invalidate_page (pd, upage);
     }
 }
 
@@ -180,7 +188,7 @@ pagedir_set_dirty (uint32_t *pd, const void *vpage, bool dirty)
       else 
         {
           *pte &= ~(uint32_t) PTE_D;
-          invalidate_pagedir (pd);
+          invalidate_page (pd, vpage);
         }
     }
 }
@@ -209,11 +217,58 @@ pagedir_set_accessed (uint32_t *pd, const void *vpage, bool accessed)
       else 
         {
           *pte &= ~(uint32_t) PTE_A; 
-          invalidate_pagedir (pd);
+          invalidate_page (pd, vpage);
+        }
+    }
+}
+
+/* Initializes BATCH as an empty batch of TLB invalidations. */
+void
+pagedir_batch_init (struct pagedir_batch *batch)
+{
+  batch->cnt = 0;
+}
+
+/* Clears the accessed bit in the PTE for virtual page VPAGE in
+   PD, like pagedir_set_accessed(), but adds the TLB invalidation
+   that this needs to BATCH instead of doing it right away.  A
+   stale TLB entry only keeps the CPU from setting the accessed
+   bit again, so this is safe to defer, unlike invalidations for
+   other changes. */
+void
+pagedir_clear_accessed_batch (struct pagedir_batch *batch, uint32_t *pd,
+                              const void *vpage)
+{
+  uint32_t *pte = lookup_page (pd, vpage, false);
+  if (pte != NULL && (*pte & PTE_A) != 0)
+    {
+      *pte &= ~(uint32_t) PTE_A;
+      if (active_pd () == pd)
+        {
+          if (batch->cnt < PAGEDIR_BATCH_SIZE)
+            batch->pages[batch->cnt] = vpage;
+          batch->cnt++;
         }
     }
 }
 
+/* Carries out the TLB invalidations in BATCH and empties it.
+   Invalidates page by page, unless so many pages are involved
+   that flushing the whole TLB is cheaper. */
+void
+pagedir_batch_flush (struct pagedir_batch *batch)
+{
+  if (batch->cnt > PAGEDIR_BATCH_SIZE)
+    invalidate_pagedir (active_pd ());
+  else
+    {
+      size_t i;
+      for (i = 0; i < batch->cnt; i++)
+        asm volatile ("invlpg (%0)" : : "r" (batch->pages[i]) : "memory");
+    }
+  batch->cnt = 0;
+}
+
 /* Loads page directory PD into the CPU's page directory base
    register. */
 void
@@ -243,6 +298,17 @@ active_pd (void)
   return ptov (pd);
 }
 
+/* Invalidates the TLB entry for virtual page VPAGE if PD is the
+   active page directory.  Unlike reloading CR3, this leaves the
+   rest of the TLB intact.  See [IA32-v2a] "INVLPG--Invalidate
+   TLB Entry". */
+static void
+invalidate_page (uint32_t *pd, const void *vpage)
+{
+  if (active_pd () == pd)
+    asm volatile ("invlpg (%0)" : : "r" (vpage) : "memory");
+}
+
 /* Seom page table changes can cause the CPU's translation
    lookaside buffer (TLB) to become out-of-sync with the page
    table.  When this happens, we have to "invalidate" the TLB by
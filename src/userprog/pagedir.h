@@ -2,8 +2,22 @@
 #define USERPROG_PAGEDIR_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
+/* Maximum number of pages a batch of TLB invalidations tracks
+   one by one.  Beyond that, flushing the batch flushes the
+   whole TLB. */
+#define PAGEDIR_BATCH_SIZE 32
+
+/* A batch of deferred TLB invalidations for the active page
+   directory. */
+struct pagedir_batch
+  {
+    size_t cnt;                         /* Number of pages invalidated. */
+    const void *pages[PAGEDIR_BATCH_SIZE]; /* First pages invalidated. */
+  };
+
 uint32_t *pagedir_create (void);
 void pagedir_destroy (uint32_t *pd);
 bool pagedir_set_page (uint32_t *pd, void *upage, void *kpage, bool rw);
@@ -13,6 +27,10 @@ bool pagedir_is_dirty (uint32_t *pd, const void *upage);
 void pagedir_set_dirty (uint32_t *pd, const void *upage, bool dirty);
 bool pagedir_is_accessed (uint32_t *pd, const void *upage);
 void pagedir_set_accessed (uint32_t *pd, const void *upage, bool accessed);
+void pagedir_batch_init (struct pagedir_batch *);
+void pagedir_clear_accessed_batch (struct pagedir_batch *, uint32_t *pd,
+                                   const void *upage);
+void pagedir_batch_flush (struct pagedir_batch *);
 void pagedir_activate (uint32_t *pd);
 
 #endif /* userprog/pagedir.h */
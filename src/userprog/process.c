@@ -7,6 +7,7 @@
 #include <string.h>
 #include "userprog/gdt.h"
 #include "userprog/pagedir.h"
+#include "userprog/syscall.h"
 #include "userprog/tss.h"
 #include "filesys/directory.h"
 #include "filesys/file.h"
@@ -19,6 +20,7 @@
 #include "threads/vaddr.h"
 #ifdef VM
 #include "vm/frame.h"
+#include "vm/mmap.h"
 #include "vm/page.h"
 #endif
 static thread_func start_process NO_RETURN;
@@ -59,11 +61,8 @@ start_process (void *file_name_)
   struct thread *curr = thread_current ();
 #ifdef VM
   /* Initialize supplemental page table. */
-  if (!vm_page_init (&curr->page_table))
+  if (!vm_page_init (curr))
     sys_exit (-1);
-  /* Initialize the list of memory mapped files. */
-  curr->max_mapid = 0;
-  list_init (&curr->mmap_list);
 #endif
   /* Initialize interrupt frame and load executable. */
   memset (&if_, 0, sizeof if_);
@@ -109,9 +108,18 @@ process_exit (void)
   struct thread *cur = thread_current ();
   uint32_t *pd;
 #ifdef VM
+  if (vm_frame_stats_at_exit && cur->pagedir != NULL)
+    printf ("%s: %u major faults, %u minor faults, %u swap-ins, "
+            "%u swap-outs, %u resident frames, %u mmap writebacks\n",
+            cur->name, cur->vmstat.major_faults, cur->vmstat.minor_faults,
+            cur->vmstat.swap_ins, cur->vmstat.swap_outs,
+            cur->vmstat.resident_frames, cur->vmstat.mmap_writebacks);
   vm_frame_acquire ();
+  vm_mmap_destroy ();
   filesys_acquire ();
-  vm_page_destroy (&cur->page_table);
+  vm_page_destroy ();
+  file_close (cur->exec_file);
+  cur->exec_file = NULL;
   filesys_release ();
   vm_frame_release ();
 #endif
@@ -329,7 +337,16 @@ load (const char *file_name, void (**eip) (void), void **esp)
 
  done:
   /* We arrive here whether the load is successful or not. */
+#ifdef VM
+  /* Pages of the executable are read in on demand and cached in
+     frames shared with other processes running it, so keep it
+     open, and unmodified, until process_exit(). */
+  if (file != NULL)
+    file_deny_write (file);
+  t->exec_file = file;
+#else
   file_close (file);
+#endif
   return success;
 }
 
@@ -419,8 +436,12 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
       struct page *page;
 
       vm_frame_acquire ();
-      vm_page_insert (upage);
-      page = vm_page_find (&thread_current ()->page_table, upage);
+      page = vm_page_insert (upage);
+      if (page == NULL)
+        {
+          vm_frame_release ();
+          return false;
+        }
       page->loaded = false;
       page->file = file;
       page->file_ofs = current_ofs;
@@ -466,7 +487,7 @@ setup_stack (void **esp)
 
 #ifdef VM
   vm_frame_acquire ();
-  kpage = frame_alloc (((uint8_t *) PHYS_BASE) - PGSIZE, PAL_ZERO);
+  kpage = vm_frame_alloc (((uint8_t *) PHYS_BASE) - PGSIZE, PAL_ZERO);
 #else
   kpage = palloc_get_page (PAL_USER | PAL_ZERO);
 #endif
@@ -18,13 +18,15 @@
 #include "filesys/off_t.h"
 #include "userprog/pagedir.h"
 #include "vm/frame.h"
-#include "vm/page.h"
+#include "vm/mmap.h"
 #endif
 static void syscall_handler (struct intr_frame *);
 static struct file *thread_fd_get (int fd);
 #ifdef VM
 static mapid_t sys_mmap (int fd, void *addr);
 static void sys_munmap (mapid_t mapid);
+static void sys_msync (mapid_t mapid);
+static void sys_vmstat (struct vmstat *stats, bool system);
 #endif
 
 static struct lock filesys_lock;
@@ -55,6 +57,9 @@ syscall_handler (struct intr_frame *f UNUSED)
 
   if (!is_user_vaddr ((int *) f->esp))
     sys_exit (-1);
+#ifdef VM
+  thread_current ()->user_esp = f->esp;
+#endif
   syscall_nr = *(int *) f->esp;
   switch (syscall_nr)
     {
@@ -72,6 +77,17 @@ syscall_handler (struct intr_frame *f UNUSED)
       mapid = *(mapid_t *) arg1;
       sys_munmap (mapid);
       break;
+    case SYS_MSYNC:
+      if (!is_user_vaddr (arg1))
+        sys_exit (-1);
+      mapid = *(mapid_t *) arg1;
+      sys_msync (mapid);
+      break;
+    case SYS_VMSTAT:
+      if (!is_user_vaddr (arg2))
+        sys_exit (-1);
+      sys_vmstat (*(struct vmstat **) arg1, *(bool *) arg2);
+      break;
 #endif
     }
 }
@@ -79,11 +95,8 @@ syscall_handler (struct intr_frame *f UNUSED)
 static mapid_t
 sys_mmap (int fd, void *addr)
 {
-  struct thread *curr = thread_current ();
-  struct page *page;
   struct file *file;
-  off_t read_bytes, current_read_bytes;
-  off_t current_ofs = 0;
+  off_t length;
   mapid_t mapid;
 
   /* File descriptors 0 and 1 are not mappable. */
@@ -98,43 +111,13 @@ sys_mmap (int fd, void *addr)
 
   /* File should have positive length. */
   filesys_acquire ();
-  read_bytes = file_length (file);
+  length = file_length (file);
   filesys_release ();
-  if (read_bytes == 0)
+  if (length == 0)
     return MAP_FAILED;
-  current_read_bytes = read_bytes;
 
   vm_frame_acquire ();
-  mapid = curr->max_mapid++;
-  while (current_read_bytes > 0)
-    {
-      if (vm_page_insert ((uint8_t *) addr + current_ofs) != NULL)
-        {
-          curr->max_mapid--;
-          while (current_ofs > 0)
-            {
-              current_ofs -= PGSIZE;
-              page = list_entry (list_pop_back (&curr->mmap_list),
-                                 struct page, elem);
-              hash_delete (&curr->page_table, &page->hash_elem);
-              free (page);
-            }
-          vm_frame_release ();
-          return MAP_FAILED;
-        }
-      page = vm_page_find (&curr->page_table, (uint8_t *) addr + current_ofs);
-      page->loaded = false;
-      page->mapid = mapid;
-      page->file = file_reopen (file);
-      page->file_ofs = current_ofs;
-      page->file_read_bytes = (current_read_bytes < PGSIZE
-                               ? current_read_bytes : PGSIZE);
-      page->file_writable = true;
-      list_push_back (&curr->mmap_list, &page->elem);
-
-      current_read_bytes -= page->file_read_bytes;
-      current_ofs += PGSIZE;
-    }
+  mapid = vm_mmap_map (file, addr, length);
   vm_frame_release ();
 
   return mapid;
@@ -145,51 +128,33 @@ sys_mmap (int fd, void *addr)
 static void
 sys_munmap (mapid_t mapid)
 {
-  struct thread *curr = thread_current ();
-  struct list_elem *e;
-  struct page *page;
-  void *kpage;
+  vm_frame_acquire ();
+  vm_mmap_unmap (mapid);
+  vm_frame_release ();
+}
 
+static void
+sys_msync (mapid_t mapid)
+{
   vm_frame_acquire ();
-  if (!list_empty (&curr->mmap_list))
-    {
-      e = list_front (&curr->mmap_list);
-      while (e != list_end (&curr->mmap_list))
-        {
-          page = list_entry (e, struct page, elem);
-          if (page->mapid < mapid)
-            {
-              e = list_next (e);
-              continue;
-            }
-          else if (page->mapid > mapid)
-            break;
-
-          e = list_next (e);
-          list_remove (&page->elem);
-          kpage = pagedir_get_page (curr->pagedir, page->addr);
-          if (kpage == NULL)
-            {
-              hash_delete (&curr->page_table, &page->hash_elem);
-              free (page);
-              continue;
-            }
-
-          if (pagedir_is_dirty (curr->pagedir, page->addr))
-            {
-              filesys_acquire ();
-              file_write_at (page->file, page->addr, page->file_read_bytes,
-                             page->file_ofs);
-              filesys_release ();
-            }
-
-          pagedir_clear_page (curr->pagedir, page->addr);
-          ASSERT (hash_delete (&curr->page_table, &page->hash_elem) != NULL);
-          free (page);
-          vm_frame_free (kpage);
-        }
-    }
+  vm_mmap_sync (mapid);
+  vm_frame_release ();
+}
+
+static void
+sys_vmstat (struct vmstat *stats, bool system)
+{
+  struct vmstat s;
+
+  if (!is_user_vaddr (stats) || !is_user_vaddr (stats + 1))
+    sys_exit (-1);
+
+  /* Copy out without the frame lock, which a fault on STATS
+     would need. */
+  vm_frame_acquire ();
+  vm_frame_get_stats (&s, system);
   vm_frame_release ();
+  *stats = s;
 }
 #endif
 /* Returns the file pointer with given FD. */
@@ -1,118 +1,363 @@
 #include "vm/frame.h"
+#include <debug.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <hash.h>
 #include <list.h>
 #include <user/syscall.h>
 #include "filesys/file.h"
-#include "threads/malloc.h"
+#include "threads/slab.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
+#include "threads/vaddr.h"
 #include "userprog/pagedir.h"
 #include "userprog/syscall.h"
+#include "vm/mmap.h"
+#include "vm/page.h"
 #include "vm/swap.h"
 
 /* Frame table. */
-static struct list frame_table;
+static struct clist frame_table;
 static struct lock frame_lock;
 
+/* Clock hand: the next frame the eviction scan will examine, or
+   a null pointer to start over at the beginning of the table. */
+static struct list_elem *clock_hand;
+
+/* TLB invalidations for accessed bits cleared by the clock hand,
+   carried out once at the end of each eviction scan. */
+static struct pagedir_batch clock_batch;
+
+/* Cache of struct frames. */
+static struct kmem_cache frame_cache;
+
+/* Shared frames, keyed by inode, offset and read bytes. */
+static struct ohash shared_frames;
+
+/* Virtual memory statistics of the whole system.  Its
+   resident_frames is computed on demand. */
+struct vmstat vm_frame_stats;
+bool vm_frame_stats_at_exit;
+
+/* A page of zeros, mapped read-only by every page that has only
+   been read since it was zero-filled. */
+static void *zero_page;
+
+static struct frame *frame_alloc (struct thread *t, void *upage,
+                                  enum palloc_flags, bool evict);
+static struct frame *frame_find (void *kpage);
+static void frame_remove (struct frame *frame);
+static struct frame *clock_advance (void);
+static bool frame_is_accessed (struct frame *frame, bool clear);
+static bool frame_is_dirty (struct frame *frame);
+static bool frame_is_mapped_file (struct frame *frame);
+static void *frame_evict (struct frame *frame);
+static struct frame *shared_find (struct page *page);
+static bool shared_is_accessed (struct frame *frame, bool clear);
+static void *shared_evict (struct frame *frame);
+static ohash_hash_func shared_hash;
+static ohash_equal_func shared_equal;
+static void frame_ctor (void *);
+
 /* Initializes the frame table. */
 void
 vm_frame_init (void)
 {
-  list_init (&frame_table);
+  clist_init (&frame_table);
   lock_init (&frame_lock);
+  kmem_cache_init (&frame_cache, "frame", sizeof (struct frame), frame_ctor);
+  ohash_init (&shared_frames, shared_hash, shared_equal, NULL);
+  zero_page = palloc_get_page (PAL_ASSERT | PAL_ZERO);
 }
 
 /* Allocates a frame. */
 void *
 vm_frame_alloc (void *upage, enum palloc_flags flags)
 {
-  struct frame *frame;
-  void *page = palloc_get_page (PAL_USER | flags);
-
-  if (page == NULL)
-    page = vm_frame_evict (flags);
+  struct frame *frame = frame_alloc (thread_current (), upage, flags, true);
+  return frame != NULL ? frame->addr : NULL;
+}
 
-  if (page != NULL)
-    {
-      frame = (struct frame *) malloc (sizeof (struct frame));
-      frame->thread = thread_current ();
-      frame->addr = page;
-      frame->upage = upage;
-      list_push_back (&frame_table, &frame->elem);
-    }
+/* Allocates a frame like vm_frame_alloc(), but only if one is
+   free: never evicts another frame.  Used for speculative
+   loads, which are not worth displacing pages in use. */
+void *
+vm_frame_try_alloc (void *upage, enum palloc_flags flags)
+{
+  return vm_frame_try_alloc_for (thread_current (), upage, flags);
+}
 
-  return page;
+/* Like vm_frame_try_alloc(), but allocates the frame for UPAGE
+   in thread T instead of the current thread. */
+void *
+vm_frame_try_alloc_for (struct thread *t, void *upage,
+                        enum palloc_flags flags)
+{
+  struct frame *frame = frame_alloc (t, upage, flags, false);
+  return frame != NULL ? frame->addr : NULL;
 }
 
 /* Frees a frame. */
 void
 vm_frame_free (void *page)
 {
-  struct list_elem *e;
-  struct frame *frame;
-  for (e = list_begin (&frame_table); e != list_end (&frame_table);
-       e = list_next (e))
+  struct frame *frame = frame_find (page);
+  if (frame != NULL)
     {
-      frame = list_entry (e, struct frame, elem);
-      if (frame->addr == page)
-        {
-          list_remove (e);
-          palloc_free_page (frame->addr);
-          free (frame);
-          break;
-        }
+      frame_remove (frame);
+      palloc_free_page (frame->addr);
+      kmem_cache_free (&frame_cache, frame);
     }
 }
 
-/* Evicts a frame and return a address of new allocated frame. */
+/* Evicts a frame and returns its page for reuse, cleared if
+   PAL_ZERO is set in FLAGS, or a null pointer if every frame is
+   pinned.  The page is handed over directly instead of going back
+   through the page allocator, where it could be taken by another
+   allocation first or, if it was borrowed from the kernel pool,
+   return to a pool that the user pool may not borrow from again.
+
+   Uses the enhanced clock algorithm.  By their accessed and
+   dirty bits, frames fall into four classes, and the hand sweeps
+   the frame table first for a frame that is neither accessed nor
+   dirty, which costs no write to evict, and then for one that is
+   dirty but not accessed, clearing accessed bits as it goes.  Two
+   rounds of both sweeps are enough to find a victim.  The hand
+   stays where it stopped, so the next call resumes there instead
+   of rescanning the start of the table.  Dirty mapped pages seen
+   along the way are left to the flusher to clean, so that later
+   scans find them clean.  TLB invalidations for cleared accessed
+   bits are batched within a sweep and carried out between
+   sweeps. */
 void *
 vm_frame_evict (enum palloc_flags flags)
 {
-  struct list_elem *e;
-  struct frame *frame = NULL;
-  struct page *page;
+  size_t frame_cnt = clist_size (&frame_table);
+  bool cleaning = false;
+  void *kpage = NULL;
+  int sweep;
 
-  /* Second chance algorithm. */
-  e = list_begin (&frame_table);
-  while (true)
+  pagedir_batch_init (&clock_batch);
+  for (sweep = 0; sweep < 4; sweep++)
     {
-      frame = list_entry (e, struct frame, elem);
-      if (pagedir_is_accessed (frame->thread->pagedir, frame->upage))
-        pagedir_set_accessed (frame->thread->pagedir, frame->upage, false);
-      else
+      bool want_dirty = sweep % 2 == 1;
+      size_t i;
+
+      for (i = 0; i < frame_cnt; i++)
         {
-          page = vm_page_find (&frame->thread->page_table, frame->upage);
-          if (pagedir_is_dirty (frame->thread->pagedir, frame->upage))
+          struct frame *frame = clock_advance ();
+          bool accessed, dirty;
+
+          if (frame->pinned)
+            continue;
+          accessed = frame_is_accessed (frame, want_dirty);
+          dirty = frame_is_dirty (frame);
+          if (!accessed && dirty == want_dirty)
             {
-              if (page->mapid != MAP_FAILED)
-                {
-                  filesys_acquire ();
-                  file_write_at (page->file, page->addr, page->file_read_bytes,
-                                 page->file_ofs);
-                  filesys_release ();
-                  page->loaded = false;
-                }
-              else
-                {
-                  page->valid = false;
-                  page->swap_idx = swap_out (frame->addr);
-                }
+              kpage = frame_evict (frame);
+              if (flags & PAL_ZERO)
+                pg_clear (kpage);
+              goto done;
+            }
+          if (dirty && !cleaning && frame_is_mapped_file (frame))
+            {
+              vm_mmap_wake_flusher ();
+              cleaning = true;
             }
-          else
-            page->loaded = false;
-          list_remove (e);
-          pagedir_clear_page (frame->thread->pagedir, frame->upage);
-          palloc_free_page (frame->addr);
-          free (frame);
-
-          return palloc_get_page (PAL_USER | flags);
         }
 
-      e = list_next (e);
-      if (e == list_end (&frame_table))
-        e = list_begin (&frame_table);
+      /* Make the accessed bits cleared in this sweep take effect
+         before the next one looks at them again, so that a page
+         touched through a stale TLB entry is seen as accessed. */
+      pagedir_batch_flush (&clock_batch);
+    }
+
+ done:
+  pagedir_batch_flush (&clock_batch);
+  return kpage;
+}
+
+/* Returns the kernel address of the shared frame that caches
+   the executable contents of PAGE, reading it from the file if
+   no other process has it cached, and records PAGE as one of
+   its sharers.  PAGE must map the frame read-only.  Returns a
+   null pointer if no frame could be obtained or the read
+   failed. */
+void *
+vm_frame_get_shared (struct page *page)
+{
+  void *kpage = vm_frame_find_shared (page);
+
+  if (kpage != NULL)
+    return kpage;
+
+  kpage = vm_frame_alloc (NULL, 0);
+  if (kpage == NULL)
+    return NULL;
+
+  filesys_acquire ();
+  if ((int) page->file_read_bytes != file_read_at (page->file, kpage,
+                                                   page->file_read_bytes,
+                                                   page->file_ofs))
+    {
+      filesys_release ();
+      vm_frame_free (kpage);
+      return NULL;
+    }
+  filesys_release ();
+  memset (kpage + page->file_read_bytes, 0, PGSIZE - page->file_read_bytes);
+
+  if (!vm_frame_add_shared (page, kpage))
+    {
+      vm_frame_free (kpage);
+      return NULL;
+    }
+  return kpage;
+}
+
+/* If the contents of PAGE are already cached in a shared frame,
+   records PAGE as one of its sharers and returns the frame's
+   kernel address.  Otherwise, returns a null pointer. */
+void *
+vm_frame_find_shared (struct page *page)
+{
+  struct frame *frame;
+
+  ASSERT (page->file != NULL);
+  ASSERT (page->mapid == MAP_FAILED);
+
+  frame = shared_find (page);
+  if (frame == NULL)
+    return NULL;
+  list_push_back (&frame->sharers, &page->share_elem);
+  return frame->addr;
+}
+
+/* Turns KPAGE, a private frame that the caller has filled with
+   the executable contents of PAGE, into the shared frame that
+   caches them, with PAGE as its only sharer.  No other shared
+   frame may cache the same contents.  Returns true if
+   successful, false if memory allocation failed, in which case
+   KPAGE stays a private frame. */
+bool
+vm_frame_add_shared (struct page *page, void *kpage)
+{
+  struct frame *frame = frame_find (kpage);
+
+  ASSERT (frame != NULL);
+  ASSERT (page->mapid == MAP_FAILED);
+  ASSERT (shared_find (page) == NULL);
+  ASSERT (list_empty (&frame->sharers));
+
+  frame->inode = file_get_inode (page->file);
+  frame->file_ofs = page->file_ofs;
+  frame->file_read_bytes = page->file_read_bytes;
+  if (!ohash_insert (&shared_frames, &frame->hash_elem))
+    {
+      frame->inode = NULL;
+      return false;
     }
+  frame->thread->vmstat.resident_frames--;
+  frame->thread = NULL;
+  frame->upage = NULL;
+  list_push_back (&frame->sharers, &page->share_elem);
+  return true;
+}
+
+/* Removes PAGE from the sharers of its shared frame, freeing
+   the frame if PAGE was the last one.  The caller must already
+   have cleared PAGE's mapping of the frame. */
+void
+vm_frame_put_shared (struct page *page, void *kpage)
+{
+  struct frame *frame = shared_find (page);
+
+  ASSERT (frame != NULL && frame->addr == kpage);
+
+  list_remove (&page->share_elem);
+  if (list_empty (&frame->sharers))
+    {
+      ohash_delete (&shared_frames, &frame->hash_elem);
+      frame_remove (frame);
+      palloc_free_page (frame->addr);
+      kmem_cache_free (&frame_cache, frame);
+    }
+}
+
+/* Gives PAGE, which maps the shared frame KPAGE, a private copy
+   of the frame's contents and returns the copy's kernel
+   address.  If PAGE is the frame's only sharer, the frame itself
+   simply becomes private to PAGE and no copy is made.  Returns
+   a null pointer if no frame could be obtained, in which case
+   PAGE still shares KPAGE. */
+void *
+vm_frame_unshare (struct page *page, void *kpage)
+{
+  struct frame *frame = shared_find (page);
+  void *copy;
+
+  ASSERT (frame != NULL && frame->addr == kpage);
+
+  list_remove (&page->share_elem);
+  if (list_empty (&frame->sharers))
+    {
+      ohash_delete (&shared_frames, &frame->hash_elem);
+      frame->thread = page->thread;
+      frame->thread->vmstat.resident_frames++;
+      frame->upage = page->addr;
+      frame->inode = NULL;
+      return frame->addr;
+    }
+
+  /* Keep the original from being evicted while we copy it. */
+  frame->pinned = true;
+  copy = vm_frame_alloc (page->addr, 0);
+  frame->pinned = false;
+  if (copy == NULL)
+    {
+      list_push_back (&frame->sharers, &page->share_elem);
+      return NULL;
+    }
+  pg_copy (copy, frame->addr);
+  return copy;
+}
+
+/* Returns the kernel address of the zero page.  It is not in
+   the frame table, so it is never evicted, and must never be
+   freed or mapped writable. */
+void *
+vm_frame_get_zero (void)
+{
+  return zero_page;
+}
+
+/* Stores the current process's virtual memory statistics, or
+   the whole system's if SYSTEM is true, into STATS. */
+void
+vm_frame_get_stats (struct vmstat *stats, bool system)
+{
+  if (system)
+    {
+      *stats = vm_frame_stats;
+      stats->resident_frames = clist_size (&frame_table);
+    }
+  else
+    *stats = thread_current ()->vmstat;
+}
+
+/* Prints virtual memory statistics. */
+void
+vm_frame_print_stats (void)
+{
+  struct vmstat s;
+
+  vm_frame_get_stats (&s, true);
+  printf ("VM: %u major faults, %u minor faults, %u swap-ins, "
+          "%u swap-outs, %u mmap writebacks\n",
+          s.major_faults, s.minor_faults, s.swap_ins, s.swap_outs,
+          s.mmap_writebacks);
 }
 
 void
@@ -126,3 +371,295 @@ vm_frame_release (void)
 {
   lock_release (&frame_lock);
 }
+
+/* Waits on COND, releasing the frame lock, which the caller must
+   hold, while asleep. */
+void
+vm_frame_wait (struct condition *cond)
+{
+  cond_wait (cond, &frame_lock);
+}
+
+/* Wakes up every thread waiting on COND with vm_frame_wait().
+   The caller must hold the frame lock. */
+void
+vm_frame_broadcast (struct condition *cond)
+{
+  cond_broadcast (cond, &frame_lock);
+}
+
+/* Sets whether the frame at KPAGE is pinned, that is, kept from
+   being evicted, to PINNED. */
+void
+vm_frame_set_pinned (void *kpage, bool pinned)
+{
+  struct frame *frame = frame_find (kpage);
+
+  ASSERT (frame != NULL);
+  frame->pinned = pinned;
+}
+
+/* Allocates a user page, evicting another frame if necessary
+   and EVICT is true, and adds it to the frame table as a private
+   frame for UPAGE in thread T. */
+static struct frame *
+frame_alloc (struct thread *t, void *upage, enum palloc_flags flags,
+             bool evict)
+{
+  struct frame *frame;
+  void *page = palloc_get_page (PAL_USER | flags);
+
+  if (page == NULL && evict)
+    page = vm_frame_evict (flags);
+  if (page == NULL)
+    return NULL;
+
+  frame = kmem_cache_alloc (&frame_cache);
+  if (frame == NULL)
+    {
+      palloc_free_page (page);
+      return NULL;
+    }
+  frame->thread = t;
+  frame->addr = page;
+  frame->upage = upage;
+  frame->pinned = false;
+  frame->inode = NULL;
+  frame->thread->vmstat.resident_frames++;
+  clist_push_back (&frame_table, &frame->elem);
+  return frame;
+}
+
+/* Returns the frame whose kernel address is KPAGE, or a null
+   pointer if there is none. */
+static struct frame *
+frame_find (void *kpage)
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&frame_table.list);
+       e != list_end (&frame_table.list); e = list_next (e))
+    {
+      struct frame *frame = list_entry (e, struct frame, elem);
+      if (frame->addr == kpage)
+        return frame;
+    }
+  return NULL;
+}
+
+/* Removes FRAME from the frame table, moving the clock hand
+   past it if necessary. */
+static void
+frame_remove (struct frame *frame)
+{
+  if (frame->thread != NULL)
+    frame->thread->vmstat.resident_frames--;
+  if (clock_hand == &frame->elem)
+    clock_hand = list_next (clock_hand);
+  clist_remove (&frame_table, &frame->elem);
+}
+
+/* Returns the frame under the clock hand and advances the hand,
+   wrapping around at the end of the frame table, which must not
+   be empty. */
+static struct frame *
+clock_advance (void)
+{
+  struct frame *frame;
+
+  ASSERT (!clist_empty (&frame_table));
+
+  if (clock_hand == NULL || clock_hand == list_end (&frame_table.list))
+    clock_hand = list_begin (&frame_table.list);
+  frame = list_entry (clock_hand, struct frame, elem);
+  clock_hand = list_next (clock_hand);
+  return frame;
+}
+
+/* Returns true if FRAME was accessed since its accessed bits
+   were last cleared, clearing them if CLEAR is true. */
+static bool
+frame_is_accessed (struct frame *frame, bool clear)
+{
+  uint32_t *pd;
+
+  if (frame->thread == NULL)
+    return shared_is_accessed (frame, clear);
+  pd = frame->thread->pagedir;
+  if (!pagedir_is_accessed (pd, frame->upage))
+    return false;
+  if (clear)
+    pagedir_clear_accessed_batch (&clock_batch, pd, frame->upage);
+  return true;
+}
+
+/* Returns true if FRAME must be written back before it can be
+   evicted.  Shared frames are mapped read-only, so they never
+   are. */
+static bool
+frame_is_dirty (struct frame *frame)
+{
+  return (frame->thread != NULL
+          && pagedir_is_dirty (frame->thread->pagedir, frame->upage));
+}
+
+/* Returns true if FRAME holds a page of a memory-mapped file. */
+static bool
+frame_is_mapped_file (struct frame *frame)
+{
+  struct page *page;
+
+  if (frame->thread == NULL)
+    return false;
+  page = vm_page_find (frame->thread, frame->upage);
+  return page != NULL && page->mapid != MAP_FAILED;
+}
+
+/* Evicts FRAME, which must not be pinned, writing it back to
+   its file or to swap if it is dirty, frees it, and returns its
+   page, which the caller now owns. */
+static void *
+frame_evict (struct frame *frame)
+{
+  struct page *page;
+  void *kpage = frame->addr;
+
+  ASSERT (!frame->pinned);
+
+  if (frame->thread == NULL)
+    return shared_evict (frame);
+
+  page = vm_page_find (frame->thread, frame->upage);
+  if (page->prefetched == frame->addr)
+    {
+      /* Read ahead from swap but never used.  The swap slot
+         still holds the contents. */
+      page->prefetched = NULL;
+    }
+  else if (pagedir_is_dirty (frame->thread->pagedir, frame->upage))
+    {
+      if (page->mapid != MAP_FAILED)
+        {
+          filesys_acquire ();
+          file_write_at (page->file, frame->addr,
+                         page->file_read_bytes, page->file_ofs);
+          filesys_release ();
+          page->loaded = false;
+          VM_STAT_ADD (frame->thread, mmap_writebacks, 1);
+        }
+      else
+        {
+          page->valid = false;
+          page->swap_idx = swap_out (frame->addr);
+          VM_STAT_ADD (frame->thread, swap_outs, 1);
+        }
+    }
+  else if (page->swap_cached)
+    {
+      /* The swap slot still holds the frame's contents. */
+      page->valid = false;
+      page->swap_cached = false;
+    }
+  else
+    page->loaded = false;
+  frame_remove (frame);
+  pagedir_clear_page (frame->thread->pagedir, frame->upage);
+  kmem_cache_free (&frame_cache, frame);
+  return kpage;
+}
+
+/* Returns the shared frame that caches PAGE's contents, or a
+   null pointer if there is none. */
+static struct frame *
+shared_find (struct page *page)
+{
+  struct frame f;
+  struct ohash_elem *e;
+
+  f.inode = file_get_inode (page->file);
+  f.file_ofs = page->file_ofs;
+  f.file_read_bytes = page->file_read_bytes;
+  e = ohash_find (&shared_frames, &f.hash_elem);
+  return e != NULL ? ohash_entry (e, struct frame, hash_elem) : NULL;
+}
+
+/* Returns true if any sharer of shared FRAME accessed it since
+   the last check, clearing every sharer's accessed bit if CLEAR
+   is true. */
+static bool
+shared_is_accessed (struct frame *frame, bool clear)
+{
+  struct list_elem *e;
+  bool accessed = false;
+
+  for (e = list_begin (&frame->sharers); e != list_end (&frame->sharers);
+       e = list_next (e))
+    {
+      struct page *page = list_entry (e, struct page, share_elem);
+      uint32_t *pd = page->thread->pagedir;
+
+      if (pagedir_is_accessed (pd, page->addr))
+        {
+          if (!clear)
+            return true;
+          pagedir_clear_accessed_batch (&clock_batch, pd, page->addr);
+          accessed = true;
+        }
+    }
+  return accessed;
+}
+
+/* Unmaps shared FRAME from all of its sharers, frees it, and
+   returns its page, which the caller now owns.  A shared frame
+   is never written, so its sharers simply reload it from the
+   file on their next access. */
+static void *
+shared_evict (struct frame *frame)
+{
+  void *kpage = frame->addr;
+
+  while (!list_empty (&frame->sharers))
+    {
+      struct list_elem *e = list_pop_front (&frame->sharers);
+      struct page *page = list_entry (e, struct page, share_elem);
+
+      pagedir_clear_page (page->thread->pagedir, page->addr);
+      page->loaded = false;
+      page->shared = false;
+    }
+  ohash_delete (&shared_frames, &frame->hash_elem);
+  frame_remove (frame);
+  kmem_cache_free (&frame_cache, frame);
+  return kpage;
+}
+
+/* Returns a hash value for shared frame F. */
+static unsigned
+shared_hash (const struct ohash_elem *f_, void *aux UNUSED)
+{
+  const struct frame *f = ohash_entry (f_, struct frame, hash_elem);
+  return hash_ptr (f->inode) ^ hash_int (f->file_ofs);
+}
+
+/* Returns true if shared frames A and B cache the same
+   contents. */
+static bool
+shared_equal (const struct ohash_elem *a_, const struct ohash_elem *b_,
+              void *aux UNUSED)
+{
+  const struct frame *a = ohash_entry (a_, struct frame, hash_elem);
+  const struct frame *b = ohash_entry (b_, struct frame, hash_elem);
+
+  return (a->inode == b->inode && a->file_ofs == b->file_ofs
+          && a->file_read_bytes == b->file_read_bytes);
+}
+
+/* Constructs a struct frame in the frame cache.  A frame's
+   sharers list is empty whenever the frame is freed, so it needs
+   to be initialized only once. */
+static void
+frame_ctor (void *frame_)
+{
+  struct frame *frame = frame_;
+  list_init (&frame->sharers);
+}
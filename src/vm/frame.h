@@ -2,23 +2,71 @@
 #define VM_FRAME_H
 
 #include <list.h>
+#include <ohash.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <user/syscall.h>
+#include "filesys/off_t.h"
 #include "threads/palloc.h"
 #include "threads/thread.h"
 
-/* Frame. */
+struct condition;
+struct inode;
+struct page;
+
+/* Frame.
+
+   A private frame belongs to the single page at UPAGE in
+   THREAD.  A shared frame has a null THREAD and caches one
+   page of an executable, identified by INODE, FILE_OFS and
+   FILE_READ_BYTES; every page that maps it read-only is on
+   SHARERS. */
 struct frame
   {
-    struct thread *thread;              /* Thread. */
+    struct thread *thread;              /* Thread, or NULL if shared. */
     void *addr;                         /* Kernel virtual address. */
     void *upage;                        /* User virtual address. */
+    bool pinned;                        /* Must not be evicted. */
+    struct inode *inode;                /* Inode of a shared frame. */
+    off_t file_ofs;                     /* Offset in INODE. */
+    uint32_t file_read_bytes;           /* Number of bytes read from INODE. */
+    struct list sharers;                /* Pages mapping a shared frame. */
+    struct ohash_elem hash_elem;        /* Shared frame table element. */
     struct list_elem elem;              /* List element. */
   };
 
+/* Virtual memory statistics of the whole system. */
+extern struct vmstat vm_frame_stats;
+
+/* If true, each process prints its virtual memory statistics
+   when it exits.  Set by the "-vs" kernel command-line
+   option. */
+extern bool vm_frame_stats_at_exit;
+
+/* Adds N to counter MEMBER of thread T's virtual memory
+   statistics and of the system's. */
+#define VM_STAT_ADD(T, MEMBER, N)                               \
+        ((T)->vmstat.MEMBER += (N), vm_frame_stats.MEMBER += (N))
+
 void vm_frame_init (void);
 void *vm_frame_alloc (void *upage, enum palloc_flags);
+void *vm_frame_try_alloc (void *upage, enum palloc_flags);
+void *vm_frame_try_alloc_for (struct thread *, void *upage,
+                              enum palloc_flags);
 void vm_frame_free (void *page);
 void *vm_frame_evict (enum palloc_flags);
+void *vm_frame_get_shared (struct page *page);
+void *vm_frame_find_shared (struct page *page);
+bool vm_frame_add_shared (struct page *page, void *kpage);
+void vm_frame_put_shared (struct page *page, void *kpage);
+void *vm_frame_unshare (struct page *page, void *kpage);
+void *vm_frame_get_zero (void);
 void vm_frame_acquire (void);
 void vm_frame_release (void);
+void vm_frame_wait (struct condition *);
+void vm_frame_broadcast (struct condition *);
+void vm_frame_set_pinned (void *kpage, bool pinned);
+void vm_frame_get_stats (struct vmstat *, bool system);
+void vm_frame_print_stats (void);
 
 #endif /* vm/frame.h */
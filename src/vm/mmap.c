@@ -0,0 +1,310 @@
+#include "vm/mmap.h"
+#include <debug.h>
+#include <round.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <list.h>
+#include "devices/timer.h"
+#include "filesys/file.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+#include "userprog/syscall.h"
+#include "vm/frame.h"
+#include "vm/page.h"
+
+/* Number of timer ticks between background writebacks. */
+#define FLUSH_INTERVAL TIMER_FREQ
+
+/* Every process's mappings, for the flusher. */
+static struct list all_regions;
+
+/* Upped every FLUSH_INTERVAL ticks to wake the flusher. */
+static struct semaphore flush_sema;
+static bool flush_enabled;
+static int flush_ticks;
+
+static thread_func flusher;
+static void region_flush (struct mmap_region *region);
+static void region_destroy (struct mmap_region *region);
+static uint8_t *region_end (const struct mmap_region *region);
+
+/* Initializes memory-mapped files and starts the flusher, a
+   kernel thread that periodically writes dirty mapped pages back
+   to their files so that munmap() and process exit find little
+   left to write. */
+void
+vm_mmap_init (void)
+{
+  list_init (&all_regions);
+  sema_init (&flush_sema, 0);
+  thread_create ("mmap-flush", PRI_DEFAULT, flusher, NULL);
+  flush_enabled = true;
+}
+
+/* Called by the timer interrupt handler on every tick. */
+void
+vm_mmap_tick (void)
+{
+  if (flush_enabled && ++flush_ticks >= FLUSH_INTERVAL)
+    {
+      flush_ticks = 0;
+      sema_up (&flush_sema);
+    }
+}
+
+/* Wakes the flusher ahead of schedule, for when eviction finds
+   dirty mapped pages that would be cheaper to evict clean. */
+void
+vm_mmap_wake_flusher (void)
+{
+  sema_up (&flush_sema);
+}
+
+/* Maps LENGTH bytes of FILE, which must be positive, into the
+   current process's address space starting at page-aligned
+   address ADDR.  Returns the new mapping's identifier, or
+   MAP_FAILED if the mapping would not lie entirely in user
+   space or would overlap pages or mappings that are already
+   there. */
+mapid_t
+vm_mmap_map (struct file *file, void *addr, off_t length)
+{
+  struct thread *t = thread_current ();
+  struct mmap_region *region;
+  uint8_t *start = addr;
+  uint8_t *end = start + ROUND_UP (length, PGSIZE);
+  struct list_elem *e;
+
+  ASSERT (pg_ofs (addr) == 0);
+  ASSERT (length > 0);
+
+  if (start == NULL || end <= start || !is_user_vaddr (end - 1))
+    return MAP_FAILED;
+  for (e = list_begin (&t->mmap_list); e != list_end (&t->mmap_list);
+       e = list_next (e))
+    {
+      struct mmap_region *r = list_entry (e, struct mmap_region, elem);
+      if (start < region_end (r) && (uint8_t *) r->start < end)
+        return MAP_FAILED;
+    }
+  if (!vm_page_range_empty (t, start, end))
+    return MAP_FAILED;
+
+  region = malloc (sizeof *region);
+  if (region == NULL)
+    return MAP_FAILED;
+  filesys_acquire ();
+  region->file = file_reopen (file);
+  filesys_release ();
+  if (region->file == NULL)
+    {
+      free (region);
+      return MAP_FAILED;
+    }
+  region->mapid = t->max_mapid++;
+  region->thread = t;
+  region->start = addr;
+  region->length = length;
+  region->file_ofs = 0;
+  region->writable = true;
+  list_init (&region->pages);
+  list_push_back (&t->mmap_list, &region->elem);
+  list_push_back (&all_regions, &region->all_elem);
+  return region->mapid;
+}
+
+/* Removes the current process's mapping MAPID, if any, writing
+   its dirty pages back to the file. */
+void
+vm_mmap_unmap (mapid_t mapid)
+{
+  struct thread *t = thread_current ();
+  struct list_elem *e;
+
+  for (e = list_begin (&t->mmap_list); e != list_end (&t->mmap_list);
+       e = list_next (e))
+    {
+      struct mmap_region *region = list_entry (e, struct mmap_region, elem);
+      if (region->mapid == mapid)
+        {
+          region_destroy (region);
+          return;
+        }
+    }
+}
+
+/* Writes the dirty pages of the current process's mapping MAPID,
+   if any, back to the file. */
+void
+vm_mmap_sync (mapid_t mapid)
+{
+  struct thread *t = thread_current ();
+  struct list_elem *e;
+
+  for (e = list_begin (&t->mmap_list); e != list_end (&t->mmap_list);
+       e = list_next (e))
+    {
+      struct mmap_region *region = list_entry (e, struct mmap_region, elem);
+      if (region->mapid == mapid)
+        {
+          region_flush (region);
+          return;
+        }
+    }
+}
+
+/* Removes all of the current process's mappings. */
+void
+vm_mmap_destroy (void)
+{
+  struct thread *t = thread_current ();
+
+  while (!list_empty (&t->mmap_list))
+    region_destroy (list_entry (list_front (&t->mmap_list),
+                                struct mmap_region, elem));
+}
+
+/* Returns T's mapping that contains ADDRESS, or a null pointer
+   if there is none. */
+struct mmap_region *
+vm_mmap_find (struct thread *t, const void *address)
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&t->mmap_list); e != list_end (&t->mmap_list);
+       e = list_next (e))
+    {
+      struct mmap_region *region = list_entry (e, struct mmap_region, elem);
+      if ((const uint8_t *) address >= (uint8_t *) region->start
+          && (const uint8_t *) address < region_end (region))
+        return region;
+    }
+  return NULL;
+}
+
+/* Creates the supplemental page table entry for UPAGE, a page
+   of REGION that has not been touched yet, and returns it.
+   Returns a null pointer if the entry could not be added. */
+struct page *
+vm_mmap_add_page (struct mmap_region *region, void *upage)
+{
+  off_t ofs = (uint8_t *) upage - (uint8_t *) region->start;
+  off_t left = region->length - ofs;
+  struct page *page;
+  struct list_elem *e;
+
+  ASSERT (pg_ofs (upage) == 0);
+  ASSERT (ofs >= 0 && ofs < region->length);
+
+  page = vm_page_insert (upage);
+  if (page == NULL)
+    return NULL;
+  page->loaded = false;
+  page->mapid = region->mapid;
+  page->file = region->file;
+  page->file_ofs = region->file_ofs + ofs;
+  page->file_read_bytes = left < PGSIZE ? left : PGSIZE;
+  page->file_writable = region->writable;
+
+  /* Keep the list in address order, which is also file offset
+     order.  Sequential access appends, so search from the back. */
+  for (e = list_rbegin (&region->pages); e != list_rend (&region->pages);
+       e = list_prev (e))
+    if (list_entry (e, struct page, elem)->addr < upage)
+      break;
+  list_insert (list_next (e), &page->elem);
+  return page;
+}
+
+/* Flusher thread.  Wakes up every FLUSH_INTERVAL ticks and
+   writes back the dirty pages of every mapping. */
+static void
+flusher (void *aux UNUSED)
+{
+  for (;;)
+    {
+      struct list_elem *e;
+
+      sema_down (&flush_sema);
+      vm_frame_acquire ();
+      for (e = list_begin (&all_regions); e != list_end (&all_regions);
+           e = list_next (e))
+        region_flush (list_entry (e, struct mmap_region, all_elem));
+      vm_frame_release ();
+    }
+}
+
+/* Writes REGION's dirty resident pages back to the file and
+   marks them clean.  The pages list is in file offset order, so
+   the writes are sequential.  The dirty bit is cleared before
+   each write, so a store that races with the write marks the
+   page dirty again rather than being lost. */
+static void
+region_flush (struct mmap_region *region)
+{
+  uint32_t *pd = region->thread->pagedir;
+  bool locked = false;
+  struct list_elem *e;
+
+  for (e = list_begin (&region->pages); e != list_end (&region->pages);
+       e = list_next (e))
+    {
+      struct page *page = list_entry (e, struct page, elem);
+      void *kpage = pagedir_get_page (pd, page->addr);
+
+      if (kpage == NULL || !pagedir_is_dirty (pd, page->addr))
+        continue;
+      pagedir_set_dirty (pd, page->addr, false);
+      if (!locked)
+        {
+          filesys_acquire ();
+          locked = true;
+        }
+      file_write_at (page->file, kpage, page->file_read_bytes,
+                     page->file_ofs);
+      VM_STAT_ADD (region->thread, mmap_writebacks, 1);
+    }
+  if (locked)
+    filesys_release ();
+}
+
+/* Unmaps REGION from the current process, writing its dirty
+   pages back to the file, and frees it. */
+static void
+region_destroy (struct mmap_region *region)
+{
+  struct thread *t = thread_current ();
+
+  region_flush (region);
+  while (!list_empty (&region->pages))
+    {
+      struct list_elem *e = list_pop_front (&region->pages);
+      struct page *page = list_entry (e, struct page, elem);
+      void *kpage = pagedir_get_page (t->pagedir, page->addr);
+
+      if (kpage != NULL)
+        {
+          pagedir_clear_page (t->pagedir, page->addr);
+          vm_frame_free (kpage);
+        }
+      vm_page_remove (page);
+    }
+
+  filesys_acquire ();
+  file_close (region->file);
+  filesys_release ();
+  list_remove (&region->elem);
+  list_remove (&region->all_elem);
+  free (region);
+}
+
+/* Returns the end of REGION, rounded up to a page boundary. */
+static uint8_t *
+region_end (const struct mmap_region *region)
+{
+  return (uint8_t *) region->start + ROUND_UP (region->length, PGSIZE);
+}
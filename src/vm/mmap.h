@@ -0,0 +1,43 @@
+#ifndef VM_MMAP_H
+#define VM_MMAP_H
+
+#include <list.h>
+#include <stdbool.h>
+#include <user/syscall.h>
+#include "filesys/off_t.h"
+#include "threads/thread.h"
+
+struct file;
+struct page;
+
+/* Memory-mapped file region.
+
+   A region is created whole by mmap(), but the supplemental page
+   table entries for its pages are only created when they are
+   first touched, so setting up a mapping costs the same for any
+   file size. */
+struct mmap_region
+  {
+    mapid_t mapid;                      /* Mapping identifier. */
+    struct thread *thread;              /* Owning process. */
+    void *start;                        /* First user virtual address. */
+    off_t length;                       /* Length in bytes. */
+    struct file *file;                  /* Mapped file. */
+    off_t file_ofs;                     /* Offset of START in FILE. */
+    bool writable;                      /* Region is writable. */
+    struct list pages;                  /* Touched pages, in address order. */
+    struct list_elem elem;              /* Owner's mmap_list element. */
+    struct list_elem all_elem;          /* List element for the flusher. */
+  };
+
+void vm_mmap_init (void);
+void vm_mmap_tick (void);
+void vm_mmap_wake_flusher (void);
+mapid_t vm_mmap_map (struct file *file, void *addr, off_t length);
+void vm_mmap_unmap (mapid_t mapid);
+void vm_mmap_sync (mapid_t mapid);
+void vm_mmap_destroy (void);
+struct mmap_region *vm_mmap_find (struct thread *t, const void *address);
+struct page *vm_mmap_add_page (struct mmap_region *region, void *upage);
+
+#endif /* vm/mmap.h */
@@ -3,204 +3,825 @@
 #include <stdbool.h>
 #include <stddef.h>
 #include <string.h>
-#include <hash.h>
 #include <user/syscall.h>
 #include "filesys/file.h"
 #include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/pte.h"
+#include "threads/slab.h"
+#include "threads/synch.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
 #include "userprog/pagedir.h"
 #include "userprog/syscall.h"
 #include "vm/frame.h"
+#include "vm/mmap.h"
 #include "vm/swap.h"
 
-static hash_hash_func page_hash;
-static hash_less_func page_less;
-static hash_action_func page_destructor;
+/* The supplemental page table is a two-level radix tree laid
+   out like the x86 page directory: a directory page indexed by
+   pd_no() points to leaf pages indexed by pt_no(), which point
+   to the struct pages.  Leaves are allocated as addresses in
+   their 4 MB are first used and freed only with the table, so a
+   lookup is two array indexes and teardown walks the pages in
+   address order.
 
-/* Initializes the supplemental page table. */
+   Number of entries in a leaf, one per page in the 4 MB of
+   address space it covers. */
+#define LEAF_ENTRIES (PGSIZE / sizeof (struct page *))
+
+static struct page **page_slot (struct thread *t, const void *address,
+                                bool create);
+static void page_destroy (struct page *page);
+static void prefetch_request (struct page *page, size_t swap_idx);
+static void prefetch_cancel (struct thread *t);
+static void prefetch_wait (struct page *page);
+static thread_func prefetcher;
+static bool page_is_writable (const struct page *page);
+static void page_fault_around (struct page *page);
+static bool stack_page_add (void *upage, bool evict);
+static void count_fault (bool major);
+
+/* Maximum number of pages in a fault-around window. */
+#define FAULT_AROUND_MAX 32
+
+/* Number of pages in the window of file-backed pages that a
+   fault on one of them brings in together.  Set by the "-fa"
+   kernel command-line option; 1 disables fault-around. */
+size_t vm_page_fault_around = 16;
+
+/* Maximum number of pages between a stack growth fault and the
+   rest of the stack that are mapped along with the faulting
+   page. */
+#define STACK_PREFAULT_MAX 16
+
+/* Maximum size of a user stack, in pages.  Set by the "-sl"
+   kernel command-line option. */
+size_t vm_page_stack_max = 2048;
+
+/* Maximum number of pages on either side of a page faulted in
+   from swap that the prefetcher reads ahead.  A neighbor is read
+   only if its swap slot is also within this distance of the
+   faulting page's, so that the reads stay close together. */
+#define PREFETCH_MAX 8
+
+/* A request to read ahead the neighbors of UPAGE in THREAD,
+   which was just faulted in from swap slot SWAP_IDX. */
+struct prefetch_request
+  {
+    struct thread *thread;              /* Faulting thread. */
+    void *upage;                        /* Faulting page. */
+    size_t swap_idx;                    /* Its swap slot. */
+    struct list_elem elem;              /* Element in prefetch_queue. */
+  };
+
+/* Cache of struct pages. */
+static struct kmem_cache page_cache;
+
+/* Pending prefetch requests, protected by the frame lock, and
+   a semaphore upped once per request. */
+static struct list prefetch_queue;
+static struct semaphore prefetch_sema;
+
+/* The page whose swap slot the prefetcher is reading with the
+   frame lock released, if any, protected by the frame lock, and
+   a condition signaled when the read completes.  Its frame is
+   pinned and already recorded as its prefetched frame. */
+static struct page *prefetch_busy;
+static struct condition prefetch_done;
+
+/* Initializes the supplemental page tables' shared state and
+   starts the prefetcher, a kernel thread that reads swapped-out
+   pages ahead of the faults that would read them one at a time.
+   It runs after the faulting process has gone back to work, so
+   the reads overlap with its execution. */
+void
+vm_page_start (void)
+{
+  kmem_cache_init (&page_cache, "page", sizeof (struct page), NULL);
+  list_init (&prefetch_queue);
+  sema_init (&prefetch_sema, 0);
+  cond_init (&prefetch_done);
+  thread_create ("swap-prefetch", PRI_DEFAULT, prefetcher, NULL);
+}
+
+/* Initializes T's supplemental page table.  Returns false if
+   memory allocation fails. */
 bool
-vm_page_init (struct hash *page_table)
+vm_page_init (struct thread *t)
 {
-  return hash_init (page_table, page_hash, page_less, NULL);
+  t->page_table = palloc_get_page (PAL_ZERO);
+  return t->page_table != NULL;
 }
 
-/* Inserts a page with given ADDRESS into the supplemental page
-   table.  If there is no such page, returns NULL. */
+/* Inserts a page with given ADDRESS into the current thread's
+   supplemental page table and returns it.  Returns a null
+   pointer if there already is such a page or memory allocation
+   fails. */
 struct page *
 vm_page_insert (const void *address)
 {
-  struct page *p = (struct page *) malloc (sizeof (struct page));
-  struct hash_elem *e;
+  struct thread *t = thread_current ();
+  struct page **slot = page_slot (t, address, true);
+  struct page *p;
+
+  if (slot == NULL || *slot != NULL)
+    return NULL;
+  p = kmem_cache_alloc (&page_cache);
+  if (p == NULL)
+    return NULL;
 
   p->addr = (void *) address;
+  p->thread = t;
   p->loaded = true;
   p->mapid = MAP_FAILED;
   p->file = NULL;
   p->valid = true;
-  e = hash_insert (&thread_current ()->page_table, &p->hash_elem);
-  if (e != NULL)
-    {
-      free (p);
-      return hash_entry (e, struct page, hash_elem);
-    }
-  return NULL;
+  p->swap_cached = false;
+  p->prefetched = NULL;
+  p->shared = false;
+  *slot = p;
+  return p;
 }
 
-/* Finds a page with the given ADDRESS from the page table. */
+/* Finds the page with the given ADDRESS in T's supplemental page
+   table.  Returns a null pointer if there is none. */
 struct page *
-vm_page_find (struct hash *page_table, const void *address)
+vm_page_find (struct thread *t, const void *address)
 {
-  struct page p;
-  struct hash_elem *e;
+  struct page **slot = page_slot (t, address, false);
+  return slot != NULL ? *slot : NULL;
+}
+
+/* Returns true if T's supplemental page table has no page in
+   the range [START, END), which must be page-aligned user
+   addresses.  A range's 4 MB stretches without a leaf table are
+   skipped in one step, so the cost depends on how much of the
+   range already has pages nearby, not on its length. */
+bool
+vm_page_range_empty (struct thread *t, const void *start, const void *end)
+{
+  const uint8_t *upage = start;
+
+  ASSERT (pg_ofs (start) == 0 && pg_ofs (end) == 0);
+  ASSERT (end <= PHYS_BASE);
+
+  if (t->page_table == NULL)
+    return true;
+  while (upage < (const uint8_t *) end)
+    {
+      struct page **leaf = t->page_table[pd_no (upage)];
+      const uint8_t *leaf_end = (const uint8_t *)
+        (((uintptr_t) upage & ~(uintptr_t) (PTSPAN - 1)) + PTSPAN);
 
-  p.addr = (void *) address;
-  e = hash_find (page_table, &p.hash_elem);
-  return e != NULL ? hash_entry (e, struct page, hash_elem) : NULL;
+      if (leaf_end > (const uint8_t *) end)
+        leaf_end = end;
+      if (leaf == NULL)
+        upage = leaf_end;
+      else
+        for (; upage < leaf_end; upage += PGSIZE)
+          if (leaf[pt_no (upage)] != NULL)
+            return false;
+    }
+  return true;
 }
 
-/* Clears the page table. */
+/* Removes PAGE from its thread's supplemental page table and
+   frees it.  The caller must already have unmapped and released
+   its frame. */
 void
-vm_page_destroy (struct hash *page_table)
+vm_page_remove (struct page *page)
 {
-  hash_destroy (page_table, page_destructor);
+  *page_slot (page->thread, page->addr, false) = NULL;
+  kmem_cache_free (&page_cache, page);
 }
 
-/* Load the given PAGE from swap. */
+/* Frees every page in the current thread's supplemental page
+   table, in address order, along with their frames and swap
+   slots, and then the table itself. */
+void
+vm_page_destroy (void)
+{
+  struct thread *t = thread_current ();
+  size_t pde, pte;
+
+  if (t->page_table == NULL)
+    return;
+  prefetch_cancel (t);
+  while (prefetch_busy != NULL && prefetch_busy->thread == t)
+    vm_frame_wait (&prefetch_done);
+  for (pde = 0; pde < pd_no (PHYS_BASE); pde++)
+    {
+      struct page **leaf = t->page_table[pde];
+      if (leaf == NULL)
+        continue;
+      for (pte = 0; pte < LEAF_ENTRIES; pte++)
+        if (leaf[pte] != NULL)
+          page_destroy (leaf[pte]);
+      palloc_free_page (leaf);
+    }
+  palloc_free_page (t->page_table);
+  t->page_table = NULL;
+}
+
+/* Load the given PAGE from swap.  WRITE is true if the fault
+   that brought it in was a write.
+
+   If the prefetcher already read PAGE, it just maps that frame.
+   Either way, it asks the prefetcher to read ahead PAGE's
+   swapped-out neighbors.
+
+   After a read fault, PAGE keeps its swap slot as a clean copy
+   of the frame and is mapped read-only, so that it can be
+   evicted again without being written until its first write;
+   see vm_page_copy_on_write(). */
 bool
-vm_page_load_swap (struct page *page)
+vm_page_load_swap (struct page *page, bool write)
 {
   struct thread *t = thread_current ();
-  void *kpage = vm_frame_alloc (page->addr, 0);
+  size_t swap_idx = page->swap_idx;
+  void *kpage;
+  bool prefetched;
   bool success;
 
   ASSERT (!page->valid);
 
-  swap_in (page, kpage);
+  prefetch_wait (page);
+  kpage = page->prefetched;
+  prefetched = kpage != NULL;
+
+  if (prefetched)
+    page->prefetched = NULL;
+  else
+    {
+      kpage = vm_frame_alloc (page->addr, 0);
+      if (kpage == NULL)
+        return false;
+      swap_in (swap_idx, kpage);
+      VM_STAT_ADD (t, swap_ins, 1);
+    }
   success = (pagedir_get_page (t->pagedir, page->addr) == NULL
-             && pagedir_set_page (t->pagedir, page->addr, kpage, true));
+             && pagedir_set_page (t->pagedir, page->addr, kpage, write));
   if (!success)
     {
-      frame_free (kpage);
+      vm_frame_free (kpage);
       return false;
     }
-  pagedir_set_dirty (t->pagedir, page->addr, true);
+  if (write)
+    {
+      swap_destroy (swap_idx);
+      pagedir_set_dirty (t->pagedir, page->addr, true);
+    }
   pagedir_set_accessed (t->pagedir, page->addr, true);
   page->valid = true;
+  page->swap_cached = !write;
+  count_fault (!prefetched);
+  prefetch_request (page, swap_idx);
   return true;
 }
 
-/* Load the given PAGE from a file. */
+/* Load the given PAGE from a file.  WRITE is true if the fault
+   that brought it in was a write. */
 bool
-vm_page_load_file (struct page *page)
+vm_page_load_file (struct page *page, bool write)
 {
   struct thread *t = thread_current ();
   void *kpage;
+  bool cached;
   bool success;
 
   ASSERT (!page->loaded);
   ASSERT (page->file != NULL);
 
   if (page->file_read_bytes == 0)
-    kpage = vm_frame_alloc (page->addr, PAL_ZERO);
-  else
-    kpage = vm_frame_alloc (page->addr, 0);
-
-  if (kpage == NULL)
-    return false;
+    return vm_page_load_zero (page, write);
 
-  if (page->file_read_bytes > 0)
+  /* Executable pages are mapped read-only from a frame shared by
+     every process running the same executable.  Writable ones
+     get a private copy on their first write; see
+     vm_page_copy_on_write(). */
+  if (page->mapid == MAP_FAILED && !(write && page->file_writable))
     {
-      filesys_acquire ();
-      if ((int) page->file_read_bytes != file_read_at (page->file, kpage,
-                                                       page->file_read_bytes,
-                                                       page->file_ofs))
+      kpage = vm_frame_find_shared (page);
+      cached = kpage != NULL;
+      if (!cached)
+        kpage = vm_frame_get_shared (page);
+      if (kpage == NULL)
+        return false;
+      success = (pagedir_get_page (t->pagedir, page->addr) == NULL
+                 && pagedir_set_page (t->pagedir, page->addr, kpage, false));
+      if (!success)
         {
-          filesys_release ();
-          vm_frame_free (kpage);
+          vm_frame_put_shared (page, kpage);
           return false;
         }
+      page->shared = true;
+      pagedir_set_accessed (t->pagedir, page->addr, true);
+      count_fault (!cached);
+      page_fault_around (page);
+      return true;
+    }
+
+  kpage = vm_frame_alloc (page->addr, 0);
+  if (kpage == NULL)
+    return false;
+
+  filesys_acquire ();
+  if ((int) page->file_read_bytes != file_read_at (page->file, kpage,
+                                                   page->file_read_bytes,
+                                                   page->file_ofs))
+    {
       filesys_release ();
-      memset (kpage + page->file_read_bytes, 0, PGSIZE - page->file_read_bytes);
+      vm_frame_free (kpage);
+      return false;
     }
+  filesys_release ();
+  memset (kpage + page->file_read_bytes, 0, PGSIZE - page->file_read_bytes);
 
   success = (pagedir_get_page (t->pagedir, page->addr) == NULL
              && pagedir_set_page (t->pagedir, page->addr, kpage,
                                   page->file_writable));
   if (!success)
     {
-      frame_free (kpage);
+      vm_frame_free (kpage);
       return false;
     }
   pagedir_set_accessed (t->pagedir, page->addr, true);
+  count_fault (true);
+  page_fault_around (page);
   return true;
 }
 
-/* Load a given PAGE with zeros. */
+/* Load a given PAGE with zeros.  WRITE is true if the fault that
+   brought it in was a write. */
 bool
-vm_page_load_zero (struct page *page)
+vm_page_load_zero (struct page *page, bool write)
 {
   struct thread *t = thread_current ();
-  void *kpage = vm_frame_alloc (page->addr, PAL_ZERO);
+  void *kpage;
   bool success;
 
   ASSERT (!page->loaded);
 
+  /* Reads are served from the zero page, mapped read-only, so
+     PAGE needs no frame of its own until it is first written;
+     see vm_page_copy_on_write(). */
+  if (!write)
+    {
+      success = (pagedir_get_page (t->pagedir, page->addr) == NULL
+                 && pagedir_set_page (t->pagedir, page->addr,
+                                      vm_frame_get_zero (), false));
+      if (success)
+        {
+          pagedir_set_accessed (t->pagedir, page->addr, true);
+          count_fault (false);
+        }
+      return success;
+    }
+
+  kpage = vm_frame_alloc (page->addr, PAL_ZERO);
   if (kpage == NULL)
     return false;
   success = (pagedir_get_page (t->pagedir, page->addr) == NULL
-             && pagedir_set_page (t->pagedir, page->addr, kpage, true));
+             && pagedir_set_page (t->pagedir, page->addr, kpage,
+                                  page_is_writable (page)));
   if (!success)
     {
       vm_frame_free (kpage);
       return false;
     }
   pagedir_set_accessed (t->pagedir, page->addr, true);
+  count_fault (false);
   return true;
 }
 
-/* Returns a hash value for page P. */
-static unsigned
-vm_page_hash (const struct hash_elem *p_, void *aux UNUSED)
+/* Handles a write to PAGE, which is mapped read-only from a
+   shared frame or from the zero page, by giving it a private
+   writable frame with the same contents.  If PAGE is instead
+   mapped read-only because its swap slot holds a clean copy,
+   the copy is about to go stale, so frees the slot and maps the
+   frame writable.  Returns false if PAGE is not a writable page
+   or no frame could be obtained. */
+bool
+vm_page_copy_on_write (struct page *page)
 {
-  const struct page *p = hash_entry (p_, struct page, hash_elem);
-  return hash_bytes (&p->addr, sizeof p->addr);
+  struct thread *t = thread_current ();
+  void *kpage = pagedir_get_page (t->pagedir, page->addr);
+
+  if (kpage == NULL || !page_is_writable (page))
+    return false;
+
+  if (kpage == vm_frame_get_zero ())
+    kpage = vm_frame_alloc (page->addr, PAL_ZERO);
+  else if (page->shared)
+    kpage = vm_frame_unshare (page, kpage);
+  else if (page->swap_cached)
+    {
+      swap_destroy (page->swap_idx);
+      page->swap_cached = false;
+    }
+  else
+    return false;
+  if (kpage == NULL)
+    return false;
+  page->shared = false;
+
+  pagedir_clear_page (t->pagedir, page->addr);
+  if (!pagedir_set_page (t->pagedir, page->addr, kpage, true))
+    {
+      vm_frame_free (kpage);
+      page->loaded = false;
+      return false;
+    }
+  pagedir_set_accessed (t->pagedir, page->addr, true);
+  count_fault (false);
+  return true;
+}
+
+/* Returns true if a fault at user address ADDR, with the user
+   stack pointer at ESP, is an access to the stack that should
+   make it grow.  The 80x86 PUSHA instruction, which pushes 32
+   bytes, is the furthest below the stack pointer that a valid
+   access may fault. */
+bool
+vm_page_is_stack_access (const void *addr, const void *esp)
+{
+  const uint8_t *stack_limit = (uint8_t *) PHYS_BASE
+                               - vm_page_stack_max * PGSIZE;
+
+  return (is_user_vaddr (addr)
+          && (const uint8_t *) addr >= stack_limit
+          && (const uint8_t *) addr >= (const uint8_t *) esp - 32);
 }
 
-/* Returns true if page A precedes page B. */
+/* Grows the stack down to include UPAGE.  If the stack pointer
+   was moved down by more than a page at once, there is a gap
+   between UPAGE and the rest of the stack that now belongs to
+   the stack too; up to STACK_PREFAULT_MAX pages of it are mapped
+   as well, so that filling in a large stack object does not
+   fault on every page. */
+bool
+vm_page_grow_stack (void *upage)
+{
+  struct thread *t = thread_current ();
+  uint8_t *p = (uint8_t *) upage + PGSIZE;
+  size_t i;
+
+  if (!stack_page_add (upage, true))
+    return false;
+  count_fault (false);
+  for (i = 0; i < STACK_PREFAULT_MAX && is_user_vaddr (p); i++, p += PGSIZE)
+    if (vm_page_find (t, p) != NULL
+        || vm_mmap_find (t, p) != NULL
+        || !stack_page_add (p, false))
+      break;
+  return true;
+}
+
+/* Adds a zeroed, writable stack page at UPAGE.  If EVICT is
+   false, only uses a free frame. */
 static bool
-vm_page_less (const struct hash_elem *a_, const struct hash_elem *b_,
-           void *aux UNUSED)
+stack_page_add (void *upage, bool evict)
 {
-  const struct page *a = hash_entry (a_, struct page, hash_elem);
-  const struct page *b = hash_entry (b_, struct page, hash_elem);
+  struct thread *t = thread_current ();
+  void *kpage;
 
-  return a->addr < b->addr;
+  kpage = (evict
+           ? vm_frame_alloc (upage, PAL_ZERO)
+           : vm_frame_try_alloc (upage, PAL_ZERO));
+  if (kpage == NULL)
+    return false;
+  if (!pagedir_set_page (t->pagedir, upage, kpage, true)
+      || vm_page_insert (upage) == NULL)
+    {
+      pagedir_clear_page (t->pagedir, upage);
+      vm_frame_free (kpage);
+      return false;
+    }
+  return true;
+}
+
+/* Counts a page fault resolved by the current process, as a
+   major fault if MAJOR is true because the page had to be read
+   from disk. */
+static void
+count_fault (bool major)
+{
+  struct thread *t = thread_current ();
+
+  if (major)
+    VM_STAT_ADD (t, major_faults, 1);
+  else
+    VM_STAT_ADD (t, minor_faults, 1);
+}
+
+/* Returns true if the user may write to PAGE. */
+static bool
+page_is_writable (const struct page *page)
+{
+  return page->file == NULL || page->file_writable;
+}
+
+/* Returns true if P belongs to the same file mapping as PAGE
+   and can be brought in along with it. */
+static bool
+fault_around_candidate (const struct page *page, const struct page *p)
+{
+  return (!p->loaded && p->valid && p->file_read_bytes > 0
+          && p->mapid == page->mapid
+          && (p->mapid != MAP_FAILED || p->file == page->file));
+}
+
+/* Loads the pages of PAGE's file mapping that lie in the same
+   fault-around window as PAGE and have not been loaded yet, so
+   that a sequential scan of the mapping does not fault on every
+   page.  Only free frames are used, and all the pages are read
+   under a single acquisition of the file system lock.  The pages
+   are mapped with their accessed bits clear, so the clock evicts
+   them first if they turn out to be unneeded. */
+static void
+page_fault_around (struct page *page)
+{
+  struct thread *t = thread_current ();
+  struct page *batch[FAULT_AROUND_MAX];
+  void *kpages[FAULT_AROUND_MAX];
+  size_t window, cnt, i;
+  uint8_t *start;
+
+  window = vm_page_fault_around;
+  if (window > FAULT_AROUND_MAX)
+    window = FAULT_AROUND_MAX;
+  if (window <= 1)
+    return;
+
+  /* Find the pages to load, taking those that another process
+     has already cached in a shared frame right away. */
+  start = (uint8_t *) (pg_no (page->addr) / window * window * PGSIZE);
+  cnt = 0;
+  for (i = 0; i < window; i++)
+    {
+      uint8_t *upage = start + i * PGSIZE;
+      struct page *p;
+      void *kpage;
+
+      if (!is_user_vaddr (upage))
+        break;
+      p = vm_page_find (t, upage);
+      if (p == NULL && page->mapid != MAP_FAILED)
+        {
+          struct mmap_region *region = vm_mmap_find (t, upage);
+          if (region != NULL && region->mapid == page->mapid)
+            p = vm_mmap_add_page (region, upage);
+        }
+      if (p == NULL || p == page || !fault_around_candidate (page, p)
+          || pagedir_get_page (t->pagedir, upage) != NULL)
+        continue;
+
+      if (p->mapid == MAP_FAILED
+          && (kpage = vm_frame_find_shared (p)) != NULL)
+        {
+          if (pagedir_set_page (t->pagedir, upage, kpage, false))
+            {
+              p->shared = true;
+              p->loaded = true;
+            }
+          else
+            vm_frame_put_shared (p, kpage);
+          continue;
+        }
+
+      kpage = vm_frame_try_alloc (upage, 0);
+      if (kpage == NULL)
+        break;
+      batch[cnt] = p;
+      kpages[cnt++] = kpage;
+    }
+  if (cnt == 0)
+    return;
+
+  /* Read them all in one go. */
+  filesys_acquire ();
+  for (i = 0; i < cnt; i++)
+    {
+      struct page *p = batch[i];
+
+      if ((int) p->file_read_bytes != file_read_at (p->file, kpages[i],
+                                                    p->file_read_bytes,
+                                                    p->file_ofs))
+        {
+          vm_frame_free (kpages[i]);
+          kpages[i] = NULL;
+        }
+    }
+  filesys_release ();
+
+  /* Map them. */
+  for (i = 0; i < cnt; i++)
+    {
+      struct page *p = batch[i];
+      void *kpage = kpages[i];
+      void *shared;
+      bool writable = p->file_writable;
+
+      if (kpage == NULL)
+        continue;
+      memset (kpage + p->file_read_bytes, 0, PGSIZE - p->file_read_bytes);
+      if (p->mapid == MAP_FAILED)
+        {
+          shared = vm_frame_find_shared (p);
+          if (shared != NULL)
+            {
+              vm_frame_free (kpage);
+              kpage = shared;
+              p->shared = true;
+            }
+          else
+            p->shared = vm_frame_add_shared (p, kpage);
+
+          /* If the frame could not be shared, it is mapped as a
+             private one instead. */
+          if (p->shared)
+            writable = false;
+        }
+
+      if (pagedir_set_page (t->pagedir, p->addr, kpage, writable))
+        p->loaded = true;
+      else if (p->shared)
+        {
+          vm_frame_put_shared (p, kpage);
+          p->shared = false;
+        }
+      else
+        vm_frame_free (kpage);
+    }
+}
+
+/* Returns the slot for virtual address ADDRESS in T's
+   supplemental page table.  If the leaf table that would hold
+   it does not exist yet, creates it if CREATE is true and
+   otherwise returns a null pointer, as it also does if creation
+   fails, ADDRESS is not a user address, or T has no table. */
+static struct page **
+page_slot (struct thread *t, const void *address, bool create)
+{
+  struct page ***pde;
+
+  if (!is_user_vaddr (address) || t->page_table == NULL)
+    return NULL;
+
+  pde = &t->page_table[pd_no (address)];
+  if (*pde == NULL)
+    {
+      if (!create)
+        return NULL;
+      *pde = palloc_get_page (PAL_ZERO);
+      if (*pde == NULL)
+        return NULL;
+    }
+  return &(*pde)[pt_no (address)];
+}
+
+/* Asks the prefetcher to read ahead the neighbors of PAGE,
+   which was just faulted in from SWAP_IDX.  Must be called with
+   the frame lock held. */
+static void
+prefetch_request (struct page *page, size_t swap_idx)
+{
+  struct prefetch_request *r = malloc (sizeof *r);
+
+  if (r == NULL)
+    return;
+  r->thread = page->thread;
+  r->upage = page->addr;
+  r->swap_idx = swap_idx;
+  list_push_back (&prefetch_queue, &r->elem);
+  sema_up (&prefetch_sema);
 }
 
-/* Free a page. */
+/* Drops T's pending prefetch requests.  Must be called with the
+   frame lock held. */
 static void
-vm_page_destructor (struct hash_elem *e, void *aux UNUSED)
+prefetch_cancel (struct thread *t)
+{
+  struct list_elem *e = list_begin (&prefetch_queue);
+
+  while (e != list_end (&prefetch_queue))
+    {
+      struct prefetch_request *r
+        = list_entry (e, struct prefetch_request, elem);
+      e = list_next (e);
+      if (r->thread == t)
+        {
+          list_remove (&r->elem);
+          free (r);
+        }
+    }
+}
+
+/* Waits until the prefetcher is done reading PAGE, if it is.
+   Must be called with the frame lock held. */
+static void
+prefetch_wait (struct page *page)
+{
+  while (prefetch_busy == page)
+    vm_frame_wait (&prefetch_done);
+}
+
+/* Reads the swapped-out neighbors of R's page, stopping in each
+   direction at the first page that is not swapped out or whose
+   slot is too far away, into frames that stay unmapped until
+   they are faulted on.  Prefetched frames are never accessed, so
+   they are the first to be evicted if they go unused; the
+   pages' swap slots are kept, so evicting them costs nothing.
+
+   Must be called with the frame lock held, but releases it
+   around each read, so that faults and evictions do not wait
+   for speculative I/O.  The frame is reserved and pinned
+   beforehand, and PREFETCH_BUSY makes a fault on the page, or
+   its process's exit, wait for the read to finish. */
+static void
+prefetch (struct prefetch_request *r)
+{
+  struct thread *t = r->thread;
+  int dir;
+
+  for (dir = -1; dir <= 1; dir += 2)
+    {
+      int i;
+
+      for (i = 1; i <= PREFETCH_MAX; i++)
+        {
+          uint8_t *upage = (uint8_t *) r->upage + dir * i * PGSIZE;
+          struct page *page = vm_page_find (t, upage);
+          size_t distance;
+          void *kpage;
+
+          if (page == NULL || page->valid || page->prefetched != NULL)
+            break;
+          distance = (page->swap_idx > r->swap_idx
+                      ? page->swap_idx - r->swap_idx
+                      : r->swap_idx - page->swap_idx);
+          if (distance > PREFETCH_MAX)
+            break;
+
+          kpage = vm_frame_try_alloc_for (t, upage, 0);
+          if (kpage == NULL)
+            return;
+          vm_frame_set_pinned (kpage, true);
+          page->prefetched = kpage;
+          prefetch_busy = page;
+
+          vm_frame_release ();
+          swap_in (page->swap_idx, kpage);
+          vm_frame_acquire ();
+
+          prefetch_busy = NULL;
+          vm_frame_set_pinned (kpage, false);
+          vm_frame_broadcast (&prefetch_done);
+          VM_STAT_ADD (t, swap_ins, 1);
+        }
+    }
+}
+
+/* Prefetcher thread.  Serves prefetch requests in order. */
+static void
+prefetcher (void *aux UNUSED)
+{
+  for (;;)
+    {
+      sema_down (&prefetch_sema);
+      vm_frame_acquire ();
+      if (!list_empty (&prefetch_queue))
+        {
+          struct list_elem *e = list_pop_front (&prefetch_queue);
+          struct prefetch_request *r
+            = list_entry (e, struct prefetch_request, elem);
+          prefetch (r);
+          free (r);
+        }
+      vm_frame_release ();
+    }
+}
+
+/* Frees PAGE, which belongs to the current thread. */
+static void
+page_destroy (struct page *page)
 {
   struct thread *t = thread_current ();
-  struct page *page;
   void *kpage;
 
-  page = hash_entry (e, struct page, hash_elem);
   kpage = pagedir_get_page (t->pagedir, page->addr);
   if (kpage != NULL)
     {
-      if (page->mapid != MAP_FAILED)
-        {
-          if (pagedir_is_dirty (t->pagedir, page->addr))
-            file_write_at (page->file, page->addr, page->file_read_bytes,
-                           page->file_ofs);
-          list_remove (&page->elem);
-        }
       pagedir_clear_page (t->pagedir, page->addr);
-      frame_free (kpage);
+      if (page->shared)
+        vm_frame_put_shared (page, kpage);
+      else if (kpage != vm_frame_get_zero ())
+        vm_frame_free (kpage);
     }
-  if (!page->valid)
+  if (page->prefetched != NULL)
+    vm_frame_free (page->prefetched);
+  if (!page->valid || page->swap_cached)
     swap_destroy (page->swap_idx);
-  free (page);
+  kmem_cache_free (&page_cache, page);
 }
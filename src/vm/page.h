@@ -4,16 +4,17 @@
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
-#include <hash.h>
 #include <list.h>
 #include <user/syscall.h>
 #include "filesys/file.h"
 #include "filesys/off_t.h"
+#include "threads/thread.h"
 
 /* Page. */
 struct page
   {
     void *addr;                         /* Virtual address. */
+    struct thread *thread;              /* Owner thread. */
     bool loaded;                        /* Page is loaded. */
     mapid_t mapid;                      /* Mapping identifier. */
     struct file *file;                  /* Loaded file. */
@@ -22,16 +23,29 @@ struct page
     bool file_writable;                 /* File is writable. */
     bool valid;                         /* Frame is not swapped out. */
     size_t swap_idx;                    /* Swap index of the frame. */
-    struct hash_elem hash_elem;         /* Hash table element. */
+    bool swap_cached;                   /* Clean copy kept in SWAP_IDX. */
+    void *prefetched;                   /* Unmapped frame read from swap. */
+    bool shared;                        /* Mapped from a shared frame. */
+    struct list_elem share_elem;        /* Shared frame sharers element. */
     struct list_elem elem;              /* List element. */
   };
 
-bool vm_page_init (struct hash *page_table);
+extern size_t vm_page_fault_around;
+extern size_t vm_page_stack_max;
+
+void vm_page_start (void);
+bool vm_page_init (struct thread *t);
 struct page *vm_page_insert (const void *address);
-struct page *vm_page_find (struct hash *page_table, const void *address);
-void vm_page_destroy (struct hash *page_table);
-bool vm_page_load_swap (struct page *page);
-bool vm_page_load_file (struct page *page);
-bool vm_page_load_zero (struct page *page);
+struct page *vm_page_find (struct thread *t, const void *address);
+bool vm_page_range_empty (struct thread *t, const void *start,
+                          const void *end);
+void vm_page_remove (struct page *page);
+void vm_page_destroy (void);
+bool vm_page_load_swap (struct page *page, bool write);
+bool vm_page_load_file (struct page *page, bool write);
+bool vm_page_load_zero (struct page *page, bool write);
+bool vm_page_copy_on_write (struct page *page);
+bool vm_page_is_stack_access (const void *addr, const void *esp);
+bool vm_page_grow_stack (void *upage);
 
 #endif /* vm/page.h */
@@ -3,13 +3,24 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <bitmap.h>
-#include "devices/disk.h"
+#include "devices/block.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
 #include "userprog/pagedir.h"
 #include "vm/frame.h"
 #include "vm/page.h"
+#include "vm/zswap.h"
+
+/* Number of sectors per page. */
+#define PAGE_SECTORS (PGSIZE / BLOCK_SECTOR_SIZE)
+
+/* Swap indexes with this bit set name pages in compressed swap
+   rather than slots on the swap device. */
+#define SWAP_COMPRESSED ((size_t) 1 << 31)
+
+/* Swap device. */
+static struct block *swap_block;
 
 /* Swap table. */
 static struct bitmap *swap_table = NULL;
@@ -19,45 +30,60 @@ static struct lock swap_lock;
 void
 swap_init (void)
 {
-  struct disk *d = disk_get (1, 1);
-  swap_table = bitmap_create (disk_size (d) * DISK_SECTOR_SIZE / PGSIZE);
+  swap_block = block_get_role (BLOCK_SWAP);
+  if (swap_block != NULL)
+    swap_table = bitmap_create (block_size (swap_block) / PAGE_SECTORS);
+  else
+    swap_table = bitmap_create (0);
   ASSERT (swap_table != NULL);
   lock_init (&swap_lock);
+  zswap_init ();
 }
 
-/* Swap out a frame. */
+/* Swap out a frame.  The frame is compressed into memory if
+   possible, and written to the swap device otherwise. */
 size_t
 swap_out (void *kpage)
 {
-  struct disk *d = disk_get (1, 1);
   size_t swap_idx;
-  disk_sector_t sec_no;
+  block_sector_t sec_no;
+
+  swap_idx = zswap_store (kpage);
+  if (swap_idx != ZSWAP_ERROR)
+    return swap_idx | SWAP_COMPRESSED;
 
   lock_acquire (&swap_lock);
   swap_idx = bitmap_scan_and_flip (swap_table, 0, 1, false);
   if (swap_idx == BITMAP_ERROR)
     PANIC ("swap_out: out of swap slots");
-  for (sec_no = 0; sec_no < PGSIZE / DISK_SECTOR_SIZE; sec_no++)
-    disk_write (d, swap_idx * PGSIZE / DISK_SECTOR_SIZE + sec_no,
-                kpage + sec_no * DISK_SECTOR_SIZE);
+  for (sec_no = 0; sec_no < PAGE_SECTORS; sec_no++)
+    block_write (swap_block, swap_idx * PAGE_SECTORS + sec_no,
+                 kpage + sec_no * BLOCK_SECTOR_SIZE);
   lock_release (&swap_lock);
   return swap_idx;
 }
 
-/* Swap the frame KPAGE in for the given PAGE. */
+/* Reads swap slot SWAP_IDX into frame KPAGE.  The slot stays
+   allocated, so that a page that is not modified afterward can
+   be evicted again without writing it; free it with
+   swap_destroy() once it is no longer needed. */
 void
-swap_in (struct page *page, void *kpage)
+swap_in (size_t swap_idx, void *kpage)
 {
-  struct disk *d = disk_get (1, 1);
-  disk_sector_t sec_no;
+  block_sector_t sec_no;
 
-  ASSERT (bitmap_test (swap_table, page->swap_idx));
+  if (swap_idx & SWAP_COMPRESSED)
+    {
+      zswap_load (swap_idx & ~SWAP_COMPRESSED, kpage);
+      return;
+    }
+
+  ASSERT (bitmap_test (swap_table, swap_idx));
 
   lock_acquire (&swap_lock);
-  for (sec_no = 0; sec_no < PGSIZE / DISK_SECTOR_SIZE; sec_no++)
-    disk_read (d, page->swap_idx * PGSIZE / DISK_SECTOR_SIZE + sec_no,
-               kpage + sec_no * DISK_SECTOR_SIZE);
-  bitmap_set (swap_table, page->swap_idx, false);
+  for (sec_no = 0; sec_no < PAGE_SECTORS; sec_no++)
+    block_read (swap_block, swap_idx * PAGE_SECTORS + sec_no,
+                kpage + sec_no * BLOCK_SECTOR_SIZE);
   lock_release (&swap_lock);
 }
 
@@ -65,6 +91,12 @@ swap_in (struct page *page, void *kpage)
 void
 swap_destroy (size_t swap_idx)
 {
+  if (swap_idx & SWAP_COMPRESSED)
+    {
+      zswap_free (swap_idx & ~SWAP_COMPRESSED);
+      return;
+    }
+
   ASSERT (bitmap_test (swap_table, swap_idx));
 
   lock_acquire (&swap_lock);
@@ -0,0 +1,236 @@
+#include "vm/zswap.h"
+#include <debug.h>
+#include <stdbool.h>
+#include <string.h>
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* Compressed swap.
+
+   Pages on their way to swap are compressed into memory first,
+   so that faulting them back in costs a decompression instead
+   of a disk read.  Compressed pages are kept zbud-style: each
+   arena page holds at most two of them, one packed against its
+   start and one against its end, which keeps allocation and
+   freeing trivial at the cost of some wasted space.  A stored
+   page is identified by twice its arena page's index, plus one
+   for the buddy at the end. */
+
+/* Number of kernel pages the arena may use. */
+#define ZSWAP_PAGES 64
+
+/* Largest compressed size worth keeping.  Pages that compress
+   worse than this go straight to the swap disk. */
+#define ZSWAP_MAX_SIZE (PGSIZE * 3 / 4)
+
+/* An arena page. */
+struct zbud_page
+  {
+    uint8_t *kpage;                     /* Kernel page, or null if unused. */
+    uint16_t size[2];                   /* Sizes of both buddies, 0 if free. */
+  };
+
+/* Arena and its lock.  Loads only read the arena, so they hold
+   the lock for reading: the swap prefetcher loads without the
+   frame lock, so its decompression can overlap a faulting
+   thread's.  Stores and frees hold it for writing. */
+static struct zbud_page arena[ZSWAP_PAGES];
+static struct rwlock zswap_lock;
+
+/* Compressor state, protected by zswap_lock held for writing. */
+#define HASH_BITS 12
+static uint16_t match_table[1 << HASH_BITS];
+static uint8_t scratch[PGSIZE];
+
+static size_t lz_compress (const uint8_t *src, uint8_t *dst, size_t dst_max);
+static void lz_decompress (const uint8_t *src, size_t size, uint8_t *dst);
+static uint8_t *buddy_addr (size_t idx);
+
+/* Initializes the compressed swap arena. */
+void
+zswap_init (void)
+{
+  rwlock_init (&zswap_lock);
+}
+
+/* Compresses the page at KPAGE into the arena and returns its
+   index, or ZSWAP_ERROR if it does not compress well enough or
+   the arena is full. */
+size_t
+zswap_store (const void *kpage)
+{
+  size_t size, i, idx = ZSWAP_ERROR;
+
+  rwlock_write_acquire (&zswap_lock);
+  size = lz_compress (kpage, scratch, ZSWAP_MAX_SIZE);
+  if (size == 0)
+    goto done;
+
+  /* Prefer filling in the free buddy of a page in use. */
+  for (i = 0; i < ZSWAP_PAGES; i++)
+    {
+      struct zbud_page *z = &arena[i];
+      if (z->kpage != NULL && (z->size[0] == 0 || z->size[1] == 0)
+          && z->size[0] + z->size[1] + size <= PGSIZE)
+        {
+          idx = i * 2 + (z->size[0] == 0 ? 0 : 1);
+          break;
+        }
+    }
+  if (idx == ZSWAP_ERROR)
+    for (i = 0; i < ZSWAP_PAGES; i++)
+      if (arena[i].kpage == NULL)
+        {
+          arena[i].kpage = palloc_get_page (0);
+          if (arena[i].kpage != NULL)
+            idx = i * 2;
+          break;
+        }
+  if (idx == ZSWAP_ERROR)
+    goto done;
+
+  arena[idx / 2].size[idx % 2] = size;
+  memcpy (buddy_addr (idx), scratch, size);
+
+ done:
+  rwlock_write_release (&zswap_lock);
+  return idx;
+}
+
+/* Decompresses the page stored at IDX into KPAGE.  The stored
+   copy is kept until zswap_free() is called. */
+void
+zswap_load (size_t idx, void *kpage)
+{
+  ASSERT (idx < ZSWAP_PAGES * 2);
+
+  rwlock_read_acquire (&zswap_lock);
+  ASSERT (arena[idx / 2].size[idx % 2] != 0);
+  lz_decompress (buddy_addr (idx), arena[idx / 2].size[idx % 2], kpage);
+  rwlock_read_release (&zswap_lock);
+}
+
+/* Frees the page stored at IDX, and its arena page if that was
+   the last page stored in it. */
+void
+zswap_free (size_t idx)
+{
+  struct zbud_page *z;
+
+  ASSERT (idx < ZSWAP_PAGES * 2);
+
+  rwlock_write_acquire (&zswap_lock);
+  z = &arena[idx / 2];
+  ASSERT (z->size[idx % 2] != 0);
+  z->size[idx % 2] = 0;
+  if (z->size[0] == 0 && z->size[1] == 0)
+    {
+      palloc_free_page (z->kpage);
+      z->kpage = NULL;
+    }
+  rwlock_write_release (&zswap_lock);
+}
+
+/* Returns the address of the page stored at IDX. */
+static uint8_t *
+buddy_addr (size_t idx)
+{
+  struct zbud_page *z = &arena[idx / 2];
+
+  return idx % 2 == 0 ? z->kpage : z->kpage + PGSIZE - z->size[1];
+}
+
+/* Compresses the page at SRC into DST and returns the
+   compressed size, or 0 if it would exceed DST_MAX bytes.
+
+   The format is a simple LZ77 variant.  Items come in groups of
+   up to eight, each group preceded by a control byte whose bit
+   I, counting from the least significant, tells whether item I
+   is a literal byte or a two-byte match.  A match holds a
+   12-bit distance back into the output, which covers a whole
+   page, and a 4-bit length of 3 to 18 bytes.  Matches are found
+   through a hash table of the last position at which each
+   3-byte prefix was seen; stale entries left over from previous
+   pages are harmless, because every candidate is verified. */
+static size_t
+lz_compress (const uint8_t *src, uint8_t *dst, size_t dst_max)
+{
+  const uint8_t *in = src;
+  const uint8_t *end = src + PGSIZE;
+  uint8_t *out = dst;
+  uint8_t *control = NULL;
+  int bit = 8;
+
+  while (in < end)
+    {
+      size_t pos = in - src;
+
+      if (bit == 8)
+        {
+          /* Room for a control byte and eight matches. */
+          if ((size_t) (out - dst) + 17 > dst_max)
+            return 0;
+          control = out++;
+          *control = 0;
+          bit = 0;
+        }
+
+      if (end - in >= 3)
+        {
+          unsigned hash = (((in[0] << 16) | (in[1] << 8) | in[2])
+                           * 2654435761u) >> (32 - HASH_BITS);
+          size_t cand = match_table[hash];
+
+          match_table[hash] = pos;
+          if (cand < pos && !memcmp (src + cand, in, 3))
+            {
+              size_t dist = pos - cand;
+              size_t len = 3;
+
+              while (len < 18 && in + len < end && src[cand + len] == in[len])
+                len++;
+              *out++ = dist >> 4;
+              *out++ = ((dist & 0xf) << 4) | (len - 3);
+              *control |= 1 << bit++;
+              in += len;
+              continue;
+            }
+        }
+      *out++ = *in++;
+      bit++;
+    }
+  return out - dst;
+}
+
+/* Decompresses the SIZE bytes at SRC, produced by lz_compress(),
+   into the page at DST. */
+static void
+lz_decompress (const uint8_t *src, size_t size, uint8_t *dst)
+{
+  const uint8_t *in = src;
+  uint8_t *out = dst;
+  uint8_t *end = dst + PGSIZE;
+
+  while (out < end)
+    {
+      uint8_t control = *in++;
+      int bit;
+
+      for (bit = 0; bit < 8 && out < end; bit++)
+        if (control & (1 << bit))
+          {
+            size_t dist = (in[0] << 4) | (in[1] >> 4);
+            size_t len = (in[1] & 0xf) + 3;
+
+            in += 2;
+            ASSERT (dist > 0 && dist <= (size_t) (out - dst));
+            ASSERT (len <= (size_t) (end - out));
+            for (; len > 0; len--, out++)
+              *out = out[-dist];
+          }
+        else
+          *out++ = *in++;
+    }
+  ASSERT (in == src + size);
+}
@@ -0,0 +1,15 @@
+#ifndef VM_ZSWAP_H
+#define VM_ZSWAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Returned by zswap_store() if a page was not stored. */
+#define ZSWAP_ERROR SIZE_MAX
+
+void zswap_init (void);
+size_t zswap_store (const void *kpage);
+void zswap_load (size_t idx, void *kpage);
+void zswap_free (size_t idx);
+
+#endif /* vm/zswap.h */